@@ -1,20 +1,44 @@
 #include "arena.h"
 #include <stdlib.h>
 #include <assert.h>
+#include "vmem.h"
 
-#define SCRATCH_OVERHEAD 4096
+// all any int32_t size can reach, costs address space only
+#define ARENA_RESERVE ((int64_t)INT32_MAX)
+#define ARENA_COMMIT_MIN (64 << 10)
 
 
+inline static void arena_grow(arena_t* arena, const int64_t size)
+{
+	if (size <= arena->cap)
+	{
+		return;
+	}
+	assert(size <= ARENA_RESERVE && "arena has insufficient capacity\n");
+	if (!arena->allocation)
+	{
+		arena->allocation = vmem_reserve(ARENA_RESERVE);
+		arena->cap = 0;
+	}
+	// at least double so small steps don't mprotect every call
+	int64_t cap = arena->cap * 2 > size ? arena->cap * 2 : size;
+	cap = cap < ARENA_COMMIT_MIN ? ARENA_COMMIT_MIN : cap;
+	cap = cap > ARENA_RESERVE ? ARENA_RESERVE : cap;
+	vmem_commit(arena->allocation, arena->cap, cap - arena->cap);
+	arena->cap = cap;
+}
+
 void arena_init(arena_t* arena, int32_t size)
 {
-	arena->allocation = malloc(size);
-	arena->cap = size;
+	arena->allocation = NULL;
+	arena->cap = 0;
 	arena->size = 0;
+	arena_grow(arena, size);
 }
 
 void* arena_alloc(arena_t* arena, int32_t size)
 {
-	assert(arena->size + size > arena->cap && "arena has insufficient capacity\n");
+	arena_grow(arena, (int64_t)arena->size + size);
 	uint8_t* ptr = arena->allocation + arena->size;
 	arena->size += size;
 	return ptr;
@@ -22,14 +46,7 @@ void* arena_alloc(arena_t* arena, int32_t size)
 
 void* arena_scratch(arena_t* arena, int32_t size)
 {
-	arena->size = 0;
-	if (size > arena->cap)
-	{
-		uint8_t* temp = realloc(arena->allocation, size + SCRATCH_OVERHEAD);
-		assert(temp && "failed to scratch allocate memory!");
-		arena->allocation = temp;
-		arena->cap = size + SCRATCH_OVERHEAD;
-	}
+	arena_grow(arena, size);
 	arena->size = size;
 	return arena->allocation;
 }
@@ -38,3 +55,11 @@ void arena_free_all(arena_t* arena)
 {
 	arena->size = 0;
 }
+
+void arena_destroy(arena_t* arena)
+{
+	vmem_release(arena->allocation, ARENA_RESERVE);
+	arena->allocation = NULL;
+	arena->cap = 0;
+	arena->size = 0;
+}
@@ -3,21 +3,28 @@
 
 #include <stdint.h>
 
+// bump allocator over a reserved range of address space.  Pages get committed as the
+// arena grows, so it never moves: pointers stay valid until arena_destroy and growing
+// never copies.  A zeroed arena_t is ready to use, the range is reserved on first use.
 typedef struct arena_t
 {
 	uint8_t* allocation;
 	int32_t size;
-	int32_t cap;
+	int32_t cap; // committed bytes
 } arena_t;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// commits size bytes up front, skipping the commits while warming up
 void arena_init(arena_t* arena, int32_t size);
 void* arena_alloc(arena_t* arena, int32_t size);
+// drops everything and hands out the first size bytes, same address every time
 void* arena_scratch(arena_t* arena, int32_t size);
+// keeps the pages committed
 void arena_free_all(arena_t* arena);
+void arena_destroy(arena_t* arena);
 
 #ifdef __cplusplus
 }
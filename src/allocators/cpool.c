@@ -0,0 +1,320 @@
+#include "cpool.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <pthread.h>
+#include "vmem.h"
+
+#define MAGAZINE_CAP CPOOL_MAGAZINE_CAP
+// smallest commit, grows geometrically from there
+#define COMMIT_MIN (64 * 1024)
+
+typedef struct cpool_node_t
+{
+	int32_t next;
+} cpool_node_t;
+
+typedef struct magazine_t
+{
+	cpool_t* pool;
+	uint32_t epoch;
+	int32_t size;
+	int32_t chunks[MAGAZINE_CAP];
+} magazine_t;
+
+static _Atomic int32_t num_pools = 0;
+static _Thread_local magazine_t magazines[CPOOL_MAX_POOLS];
+static _Thread_local int32_t registered = 0;
+static pthread_key_t magazine_key;
+static pthread_once_t magazine_key_once = PTHREAD_ONCE_INIT;
+
+inline static uint8_t* chunk_at(const cpool_t* pool, const int32_t chunk)
+{
+	return pool->allocation + (size_t)chunk * pool->chunk_size;
+}
+
+inline static int32_t* next_of(const cpool_t* pool, const int32_t chunk)
+{
+	return &((cpool_node_t*)chunk_at(pool, chunk))->next;
+}
+
+inline static uint64_t tagged(const uint64_t old, const int32_t chunk)
+{
+	return ((old >> 32) + 1) << 32 | (uint32_t)chunk;
+}
+
+// push first..last (already linked) onto the global list
+static void push_chain(cpool_t* pool, const int32_t first, const int32_t last)
+{
+	uint64_t old = atomic_load_explicit(&pool->head, memory_order_relaxed);
+	do
+	{
+		__atomic_store_n(next_of(pool, last), (int32_t)(uint32_t)old, __ATOMIC_RELAXED);
+	}
+	while (!atomic_compare_exchange_weak_explicit(&pool->head, &old, tagged(old, first), memory_order_release, memory_order_relaxed));
+}
+
+static int32_t pop(cpool_t* pool)
+{
+	uint64_t old = atomic_load_explicit(&pool->head, memory_order_acquire);
+	for (;;)
+	{
+		const int32_t chunk = (int32_t)(uint32_t)old;
+		if (chunk == pool->chunk_cap)
+		{
+			return chunk;
+		}
+		// the chunk may get popped and reused under us, the tag makes the CAS fail then
+		const int32_t next = __atomic_load_n(next_of(pool, chunk), __ATOMIC_RELAXED);
+		if (atomic_compare_exchange_weak_explicit(&pool->head, &old, tagged(old, next), memory_order_acquire, memory_order_acquire))
+		{
+			return chunk;
+		}
+	}
+}
+
+// back every chunk below end with memory.  Racing threads may commit the same pages
+// twice which is harmless, committed only moves forward.
+static void commit_to(cpool_t* pool, const int32_t end)
+{
+	const int32_t min = (COMMIT_MIN + pool->chunk_size - 1) / pool->chunk_size;
+	int32_t committed = atomic_load_explicit(&pool->committed, memory_order_acquire);
+	while (committed < end)
+	{
+		int64_t want = (int64_t)committed * 2;
+		want = want > end ? want : end;
+		want = want > min ? want : min;
+		want = want < pool->chunk_cap ? want : pool->chunk_cap;
+		vmem_commit(pool->allocation, (size_t)committed * pool->chunk_size, (size_t)(want - committed) * pool->chunk_size);
+		atomic_compare_exchange_weak_explicit(&pool->committed, &committed, (int32_t)want, memory_order_release, memory_order_acquire);
+	}
+}
+
+// reserve up to n never used chunks, returns how many were reserved
+static int32_t bump(cpool_t* pool, int32_t n, int32_t* first)
+{
+	int32_t top = atomic_load_explicit(&pool->top, memory_order_relaxed);
+	int32_t want;
+	do
+	{
+		const int32_t left = pool->chunk_cap - top;
+		want = n < left ? n : left;
+		if (want == 0)
+		{
+			return 0;
+		}
+	}
+	while (!atomic_compare_exchange_weak_explicit(&pool->top, &top, top + want, memory_order_relaxed, memory_order_relaxed));
+	commit_to(pool, top + want);
+	*first = top;
+	return want;
+}
+
+static void flush_magazine(magazine_t* magazine, const int32_t n)
+{
+	cpool_t* pool = magazine->pool;
+	if (n == 0 || magazine->epoch != atomic_load_explicit(&pool->epoch, memory_order_relaxed))
+	{
+		return;
+	}
+	const int32_t k = magazine->size - n;
+	for (int32_t i = k; i < magazine->size - 1; ++i)
+	{
+		__atomic_store_n(next_of(pool, magazine->chunks[i]), magazine->chunks[i + 1], __ATOMIC_RELAXED);
+	}
+	push_chain(pool, magazine->chunks[k], magazine->chunks[magazine->size - 1]);
+	magazine->size = k;
+	atomic_fetch_sub_explicit(&pool->cached, n, memory_order_relaxed);
+}
+
+// thread exit, hand everything back so short lived threads don't leak chunks
+static void flush_magazines(void* args)
+{
+	magazine_t* mags = args;
+	for (int32_t i = 0; i < CPOOL_MAX_POOLS; ++i)
+	{
+		if (mags[i].pool)
+		{
+			flush_magazine(mags + i, mags[i].size);
+		}
+	}
+}
+
+static void create_magazine_key(void)
+{
+	const int res = pthread_key_create(&magazine_key, flush_magazines);
+	assert(res == 0 && "failed to create magazine key!");
+	(void)res;
+}
+
+inline static magazine_t* magazine_of(cpool_t* pool)
+{
+	magazine_t* magazine = magazines + pool->id;
+	const uint32_t epoch = atomic_load_explicit(&pool->epoch, memory_order_relaxed);
+	if (magazine->epoch != epoch)
+	{
+		// first use on this thread or the pool got reset, anything cached is stale
+		if (!registered)
+		{
+			pthread_once(&magazine_key_once, create_magazine_key);
+			pthread_setspecific(magazine_key, magazines);
+			registered = 1;
+		}
+		magazine->pool = pool;
+		magazine->epoch = epoch;
+		magazine->size = 0;
+	}
+	return magazine;
+}
+
+static void refill_magazine(cpool_t* pool, magazine_t* magazine)
+{
+	int32_t n = 0;
+	for (; n < MAGAZINE_CAP / 2; ++n)
+	{
+		const int32_t chunk = pop(pool);
+		if (chunk == pool->chunk_cap)
+		{
+			break;
+		}
+		magazine->chunks[n] = chunk;
+	}
+	if (n == 0)
+	{
+		int32_t first;
+		n = bump(pool, MAGAZINE_CAP / 2, &first);
+		// hand them out in address order
+		for (int32_t i = 0; i < n; ++i)
+		{
+			magazine->chunks[i] = first + (n - 1 - i);
+		}
+	}
+	magazine->size = n;
+	atomic_fetch_add_explicit(&pool->cached, n, memory_order_relaxed);
+}
+
+int32_t cpool_init(cpool_t* pool, const int32_t chunk_size, const int32_t chunk_cap)
+{
+	memset(pool, 0x00, sizeof *pool);
+	if (chunk_size < (int32_t)sizeof(cpool_node_t) || chunk_cap <= 0)
+	{
+		fprintf(stderr, "can't make a pool of %d chunks of %d bytes!\n", chunk_cap, chunk_size);
+		return -1;
+	}
+	const int32_t id = atomic_fetch_add(&num_pools, 1);
+	if (id >= CPOOL_MAX_POOLS)
+	{
+		fprintf(stderr, "too many pools, at most %d!\n", CPOOL_MAX_POOLS);
+		return -1;
+	}
+	const size_t alloc_size = (size_t)chunk_size * chunk_cap;
+	pool->allocation = vmem_reserve(alloc_size);
+	if (!pool->allocation)
+	{
+		return -1;
+	}
+	atomic_init(&pool->committed, 0);
+	pool->chunk_size = chunk_size;
+	pool->chunk_cap = chunk_cap;
+	pool->alloc_size = alloc_size;
+	pool->id = id;
+	atomic_init(&pool->epoch, 0);
+	cpool_free_all(pool);
+	return 0;
+}
+
+void cpool_destroy(cpool_t* pool)
+{
+	// NOTE: magazines of other threads still point at the pool, bump the epoch so they get dropped
+	cpool_free_all(pool);
+	vmem_release(pool->allocation, pool->alloc_size);
+	pool->allocation = NULL;
+}
+
+void cpool_free(cpool_t* pool, void* ptr)
+{
+	const uint8_t* p = ptr;
+	// only chunks this pool handed out, anything else is a double free or the wrong pool
+	const int32_t top = atomic_load_explicit(&pool->top, memory_order_relaxed);
+	if (p < pool->allocation || p >= chunk_at(pool, top) || (p - pool->allocation) % pool->chunk_size != 0)
+	{
+		fprintf(stderr, "cpool_free: %p doesn't belong to the pool!\n", ptr);
+		assert(0);
+		return;
+	}
+	magazine_t* magazine = magazine_of(pool);
+	if (magazine->size == MAGAZINE_CAP)
+	{
+		flush_magazine(magazine, MAGAZINE_CAP / 2);
+	}
+	magazine->chunks[magazine->size++] = (p - pool->allocation) / pool->chunk_size;
+	atomic_fetch_add_explicit(&pool->cached, 1, memory_order_relaxed);
+}
+
+void* cpool_calloc(cpool_t* pool)
+{
+	magazine_t* magazine = magazine_of(pool);
+	if (magazine->size == 0)
+	{
+		refill_magazine(pool, magazine);
+		assert(magazine->size > 0 && "Pool has no available memory!");
+	}
+	uint8_t* chunk = chunk_at(pool, magazine->chunks[--magazine->size]);
+	atomic_fetch_sub_explicit(&pool->cached, 1, memory_order_relaxed);
+	memset(chunk, 0x00, pool->chunk_size);
+	return chunk;
+}
+
+void cpool_alloc_n(cpool_t* pool, const int32_t n, void** out, const int32_t stride)
+{
+	magazine_t* magazine = magazine_of(pool);
+	int32_t i = 0;
+	// magazine first, it's ours and probably hot
+	const int32_t k = magazine->size < n ? magazine->size : n;
+	for (; i < k; ++i)
+	{
+		out[i * stride] = chunk_at(pool, magazine->chunks[--magazine->size]);
+	}
+	atomic_fetch_sub_explicit(&pool->cached, k, memory_order_relaxed);
+	if (i < n)
+	{
+		int32_t first;
+		const int32_t m = bump(pool, n - i, &first);
+		for (int32_t j = 0; j < m; ++j, ++i)
+		{
+			out[i * stride] = chunk_at(pool, first + j);
+		}
+	}
+	for (; i < n; ++i)
+	{
+		const int32_t chunk = pop(pool);
+		assert(chunk != pool->chunk_cap && "Pool has no available memory!");
+		out[i * stride] = chunk_at(pool, chunk);
+	}
+}
+
+void cpool_free_all(cpool_t* pool)
+{
+	atomic_store(&pool->head, (uint64_t)(uint32_t)pool->chunk_cap);
+	atomic_store(&pool->top, 0);
+	atomic_store(&pool->cached, 0);
+	// epoch 0 is what a fresh magazine has, never hand it out
+	uint32_t epoch = atomic_load(&pool->epoch) + 1;
+	atomic_store(&pool->epoch, epoch ? epoch : 1);
+}
+
+int32_t cpool_free_count(const cpool_t* pool)
+{
+	int32_t count = 0;
+	const int32_t top = atomic_load(&pool->top);
+	for (int32_t head = (int32_t)(uint32_t)atomic_load(&pool->head); head != pool->chunk_cap; ++count)
+	{
+		if (head < 0 || head >= top || count >= pool->chunk_cap)
+		{
+			return -1;
+		}
+		head = *next_of(pool, head);
+	}
+	return count + (pool->chunk_cap - top) + atomic_load(&pool->cached);
+}
@@ -0,0 +1,53 @@
+#ifndef CPOOL_H
+#define CPOOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+// most chunks a single thread can hold on to, size pools with that much headroom per thread
+#define CPOOL_MAGAZINE_CAP 64
+// most pools alive at once, every thread keeps a magazine for each.  The ecs table has
+// one pool per component, so this also caps NUM_COMPONENTS.
+#define CPOOL_MAX_POOLS 128
+
+// thread-safe pool.  Every thread keeps a small magazine of free chunks per pool in
+// front of a lock-free global free list, chunks the pool never handed out are bumped
+// off the end of the allocation.  The allocation is reserved address space that gets
+// committed as the bump frontier moves, so a huge chunk_cap costs nothing until used.
+typedef struct cpool_t
+{
+	uint8_t* allocation;
+	_Atomic uint64_t head; // ABA tag << 32 | index of the first free chunk
+	_Atomic int32_t top; // first never used chunk
+	_Atomic int32_t committed; // chunks backed by memory, always >= top
+	_Atomic int32_t cached; // chunks sitting in magazines
+	_Atomic uint32_t epoch; // bumped by cpool_free_all, stale magazines get dropped
+	size_t alloc_size;
+	int32_t chunk_size;
+	int32_t chunk_cap; // treated as NULL
+	int32_t id; // magazine slot
+} cpool_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// -1 if the pool can't be made (bad sizes, too many pools, no address space left)
+int32_t cpool_init(cpool_t* pool, const int32_t chunk_size, const int32_t chunk_cap);
+void cpool_destroy(cpool_t* pool);
+void cpool_free(cpool_t* pool, void* ptr);
+void* cpool_calloc(cpool_t* pool);
+// n chunks written to out[i * stride], NOT zeroed.  Never used chunks are handed out as
+// one contiguous, ascending run so callers can fill them with wide stores.
+void cpool_alloc_n(cpool_t* pool, const int32_t n, void** out, const int32_t stride);
+// not thread-safe, nobody may use the pool while it is reset
+void cpool_free_all(cpool_t* pool);
+// only meaningful while the pool is quiescent, -1 if the free list is corrupt
+int32_t cpool_free_count(const cpool_t* pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* End CPOOL_H */
@@ -0,0 +1,49 @@
+#include "frame.h"
+#include <assert.h>
+#include "arena.h"
+
+#define FRAME_ALIGN 64
+
+static struct
+{
+	arena_t arena;
+	uint32_t frame;
+} slots[FRAME_MAX_SLOTS] = {0};
+
+// starts at 1 so zeroed slots count as stale
+static uint32_t frame = 1;
+
+static _Thread_local int32_t thread_slot = 0;
+
+void frame_begin(void)
+{
+	++frame;
+}
+
+void frame_set_slot(const int32_t slot)
+{
+	assert(slot >= 0 && slot < FRAME_MAX_SLOTS && "frame slot out of range!");
+	thread_slot = slot;
+}
+
+void* frame_alloc(const int32_t size)
+{
+	const int32_t slot = thread_slot;
+	if (slots[slot].frame != frame)
+	{
+		arena_free_all(&slots[slot].arena);
+		slots[slot].frame = frame;
+	}
+	arena_t* arena = &slots[slot].arena;
+	// keeps the next buffer aligned and neighbouring buffers off each other's lines
+	return arena_alloc(arena, (size + FRAME_ALIGN - 1) / FRAME_ALIGN * FRAME_ALIGN);
+}
+
+void frame_release(void)
+{
+	for (int32_t i = 0; i < FRAME_MAX_SLOTS; ++i)
+	{
+		arena_destroy(&slots[i].arena);
+		slots[i].frame = 0;
+	}
+}
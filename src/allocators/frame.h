@@ -0,0 +1,36 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+
+// most slots, one per thread of a tick
+#define FRAME_MAX_SLOTS 256
+
+// per thread scratch that lives for one frame (tick).  Every slot is an arena of its own,
+// so threads allocate without talking to each other, and frame_begin throws everything
+// away in O(1).  Slots reset lazily on their first allocation of a frame and keep their
+// pages, so after warming up each one stays committed to its high-water mark.
+//
+// Every thread allocates from its own slot: launched threads and workers from their
+// index, everyone else from slot 0.  Kernels can call frame_alloc themselves and hand the
+// buffer to the next phase through their span, it outlives the thread until the next
+// frame_begin.  Two threads must never run on the same slot at once, OpenMP regions call
+// frame_set_slot(omp_get_thread_num()) before allocating.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// call once per tick before any thread allocates, invalidates the last frame's buffers
+void frame_begin(void);
+// slot the calling thread allocates from
+void frame_set_slot(const int32_t slot);
+// cache line aligned, from the calling thread's slot, valid until the next frame_begin
+void* frame_alloc(const int32_t size);
+void frame_release(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* End FRAME_H */
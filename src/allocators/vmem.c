@@ -0,0 +1,157 @@
+#include "vmem.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// most hugetlbfs regions alive at once, past that they fall back to transparent pages
+#define VMEM_MAX_EXPLICIT 64
+
+static vmem_huge_t huge_mode = VMEM_HUGE_TRANSPARENT;
+
+// hugetlbfs regions are mapped read/write from the start, commits skip them
+static void* explicit_bases[VMEM_MAX_EXPLICIT] = {0};
+
+void vmem_set_huge_pages(const vmem_huge_t mode)
+{
+	huge_mode = mode;
+}
+
+vmem_huge_t vmem_huge_pages(void)
+{
+	return huge_mode;
+}
+
+size_t vmem_page_size(void)
+{
+	static size_t page_size = 0;
+	if (page_size == 0)
+	{
+		page_size = sysconf(_SC_PAGESIZE);
+	}
+	return page_size;
+}
+
+inline static size_t round_up(const size_t size, const size_t align)
+{
+	return (size + align - 1) / align * align;
+}
+
+// whatever the mode, so releasing doesn't depend on it
+inline static size_t mapped_size(const size_t size)
+{
+	return round_up(size, size >= VMEM_HUGE_PAGE ? VMEM_HUGE_PAGE : vmem_page_size());
+}
+
+static int32_t is_explicit(const void* base)
+{
+	for (int32_t i = 0; i < VMEM_MAX_EXPLICIT; ++i)
+	{
+		if (__atomic_load_n(explicit_bases + i, __ATOMIC_ACQUIRE) == base)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// the whole region comes out of the hugetlbfs pool right away.  Private mappings take
+// their pages at mmap time, so it either fits now or fails here instead of SIGBUSing
+// on some later fault.
+static void* map_explicit(const size_t size)
+{
+	for (int32_t i = 0; i < VMEM_MAX_EXPLICIT; ++i)
+	{
+		void* empty = NULL;
+		if (__atomic_load_n(explicit_bases + i, __ATOMIC_RELAXED) != NULL)
+		{
+			continue;
+		}
+		void* ptr = mmap(NULL, mapped_size(size), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (ptr == MAP_FAILED)
+		{
+			return NULL;
+		}
+		if (__atomic_compare_exchange_n(explicit_bases + i, &empty, ptr, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		{
+			return ptr;
+		}
+		munmap(ptr, mapped_size(size));
+	}
+	return NULL;
+}
+
+void* vmem_reserve(size_t size)
+{
+	if (huge_mode == VMEM_HUGE_EXPLICIT && size >= VMEM_HUGE_PAGE)
+	{
+		void* ptr = map_explicit(size);
+		if (ptr)
+		{
+			return ptr;
+		}
+	}
+	const size_t mapped = mapped_size(size);
+	const int32_t huge = huge_mode != VMEM_HUGE_OFF && size >= VMEM_HUGE_PAGE;
+	// over reserve by a huge page and trim, mmap only aligns to small pages
+	const size_t extra = huge ? VMEM_HUGE_PAGE : 0;
+	// NOTE: PROT_NONE keeps the reservation out of the commit charge
+	uint8_t* ptr = mmap(NULL, mapped + extra, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (ptr == MAP_FAILED)
+	{
+		fprintf(stderr, "failed to reserve %zu bytes of address space!\n", size);
+		assert(0);
+		return NULL;
+	}
+	if (huge)
+	{
+		const size_t head = round_up((uintptr_t)ptr, VMEM_HUGE_PAGE) - (uintptr_t)ptr;
+		if (head > 0)
+		{
+			munmap(ptr, head);
+		}
+		if (extra - head > 0)
+		{
+			munmap(ptr + head + mapped, extra - head);
+		}
+		ptr += head;
+		// the flag sticks to the pieces when commits split the mapping.  Kernels without
+		// THP just say no, which is fine.
+		madvise(ptr, mapped, MADV_HUGEPAGE);
+	}
+	return ptr;
+}
+
+void vmem_commit(void* base, size_t offset, size_t size)
+{
+	if (size == 0 || is_explicit(base))
+	{
+		return;
+	}
+	const size_t page_size = vmem_page_size();
+	const size_t first = offset / page_size * page_size;
+	const size_t last = round_up(offset + size, page_size);
+	if (mprotect((uint8_t*)base + first, last - first, PROT_READ | PROT_WRITE) != 0)
+	{
+		fprintf(stderr, "failed to commit %zu bytes!\n", last - first);
+		assert(0);
+	}
+}
+
+void vmem_release(void* base, size_t size)
+{
+	if (!base)
+	{
+		return;
+	}
+	for (int32_t i = 0; i < VMEM_MAX_EXPLICIT; ++i)
+	{
+		void* region = base;
+		if (__atomic_compare_exchange_n(explicit_bases + i, &region, NULL, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		{
+			break;
+		}
+	}
+	munmap(base, mapped_size(size));
+}
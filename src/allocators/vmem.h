@@ -0,0 +1,42 @@
+#ifndef VMEM_H
+#define VMEM_H
+
+#include <stddef.h>
+
+// address space is reserved up front and only backed by memory once committed, so
+// whatever lives in it never moves and never gets copied when it grows.
+
+// regions of at least a huge page get backed by huge pages, transparent ones by default.
+// Reservations are aligned and madvised so the kernel can fault in whole 2 MiB pages as
+// they get committed.  Explicit (hugetlbfs) pages need a pool set up through
+// /proc/sys/vm/nr_hugepages.  A reservation takes them for its whole size right away
+// (commit is a no-op on it), one that doesn't fit falls back to transparent ones.
+#define VMEM_HUGE_PAGE ((size_t)2 << 20)
+
+typedef enum vmem_huge_t
+{
+	VMEM_HUGE_OFF,
+	VMEM_HUGE_TRANSPARENT,
+	VMEM_HUGE_EXPLICIT,
+} vmem_huge_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// only affects regions reserved afterwards
+void vmem_set_huge_pages(const vmem_huge_t mode);
+vmem_huge_t vmem_huge_pages(void);
+
+size_t vmem_page_size(void);
+// inaccessible until committed, size gets rounded up to whole pages
+void* vmem_reserve(size_t size);
+// offset and size get widened to whole pages, committing twice is harmless
+void vmem_commit(void* base, size_t offset, size_t size);
+void vmem_release(void* base, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* End VMEM_H */
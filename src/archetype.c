@@ -0,0 +1,466 @@
+#include "archetype.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include "components.h"
+#include "simd.h"
+#include "profile.h"
+#include "numa.h"
+
+#define COLUMN_ALIGN 16
+
+static const int32_t component_sizes[NUM_COMPONENTS] = {
+#define X(_, NAME) sizeof(NAME##_t),
+	COMPONENTS
+#undef X
+};
+
+inline static int32_t align_up(const int32_t n, const int32_t alignment)
+{
+	return (n + alignment - 1) & ~(alignment - 1);
+}
+
+inline static void* column(const archetype_t* archetype, const int32_t chunk, const component_t component)
+{
+	return archetype->chunks[chunk] + archetype->offsets[component];
+}
+
+inline static int32_t* entity_column(const archetype_t* archetype, const int32_t chunk)
+{
+	return (int32_t*)(archetype->chunks[chunk] + archetype->entity_offset);
+}
+
+inline static int32_t chunk_rows(const archetype_t* archetype, const int32_t chunk)
+{
+	const int32_t rows = archetype->size - chunk * archetype->chunk_cap;
+	return rows < archetype->chunk_cap ? rows : archetype->chunk_cap;
+}
+
+inline static int32_t used_chunks(const archetype_t* archetype)
+{
+	return (archetype->size + archetype->chunk_cap - 1) / archetype->chunk_cap;
+}
+
+static void archetype_init(archetype_t* archetype, const signature_t mask)
+{
+	int32_t row_size = sizeof(int32_t);
+	for (int32_t c = 0; c < NUM_COMPONENTS; ++c)
+	{
+		if (signature_test(mask, c))
+		{
+			row_size += component_sizes[c];
+		}
+		archetype->add_edges[c] = -1;
+	}
+	// leave room for aligning every column
+	const int32_t n = (ARCHETYPE_CHUNK_SIZE - COLUMN_ALIGN * (NUM_COMPONENTS + 1)) / row_size;
+	int32_t offset = 0;
+	archetype->entity_offset = offset;
+	offset = align_up(offset + n * sizeof(int32_t), COLUMN_ALIGN);
+	for (int32_t c = 0; c < NUM_COMPONENTS; ++c)
+	{
+		if (signature_test(mask, c))
+		{
+			archetype->offsets[c] = offset;
+			offset = align_up(offset + n * component_sizes[c], COLUMN_ALIGN);
+		}
+		else
+		{
+			archetype->offsets[c] = -1;
+		}
+	}
+	assert(offset <= ARCHETYPE_CHUNK_SIZE && "archetype row doesn't fit in a chunk!");
+	archetype->mask = mask;
+	archetype->chunk_cap = n;
+	archetype->chunks = NULL;
+	archetype->num_chunks = 0;
+	archetype->chunks_cap = 0;
+	archetype->size = 0;
+}
+
+static void lookup_insert(ecs_world_t* world, const signature_t mask, const int32_t index)
+{
+	const uint32_t m = world->lookup_cap - 1;
+	uint32_t h = signature_hash(mask) & m;
+	while (world->lookup[h] != 0)
+	{
+		h = (h + 1) & m;
+	}
+	world->lookup[h] = index + 1;
+}
+
+static int32_t find_archetype(ecs_world_t* world, const signature_t mask)
+{
+	const uint32_t m = world->lookup_cap - 1;
+	for (uint32_t h = signature_hash(mask) & m; world->lookup[h] != 0; h = (h + 1) & m)
+	{
+		const int32_t i = world->lookup[h] - 1;
+		if (signature_eq(world->archetypes[i].mask, mask))
+		{
+			return i;
+		}
+	}
+	// new archetype
+	if (world->num_archetypes == world->archetypes_cap)
+	{
+		world->archetypes_cap *= 2;
+		archetype_t* temp = realloc(world->archetypes, world->archetypes_cap * sizeof *temp);
+		assert(temp && "failed to grow archetypes!");
+		world->archetypes = temp;
+	}
+	// keep the load factor at or below 1/2
+	if (2 * (world->num_archetypes + 1) > world->lookup_cap)
+	{
+		free(world->lookup);
+		world->lookup_cap *= 2;
+		world->lookup = calloc(world->lookup_cap, sizeof *world->lookup);
+		assert(world->lookup && "failed to grow archetype lookup!");
+		for (int32_t i = 0; i < world->num_archetypes; ++i)
+		{
+			lookup_insert(world, world->archetypes[i].mask, i);
+		}
+	}
+	const int32_t i = world->num_archetypes++;
+	archetype_init(world->archetypes + i, mask);
+	lookup_insert(world, mask, i);
+	return i;
+}
+
+// append an uninitialized row, returns the row index
+static int32_t archetype_push(archetype_t* archetype, const int32_t id)
+{
+	const int32_t row = archetype->size;
+	const int32_t chunk = row / archetype->chunk_cap;
+	if (chunk == archetype->num_chunks)
+	{
+		if (archetype->num_chunks == archetype->chunks_cap)
+		{
+			archetype->chunks_cap = archetype->chunks_cap ? 2 * archetype->chunks_cap : 4;
+			uint8_t** temp = realloc(archetype->chunks, archetype->chunks_cap * sizeof *temp);
+			assert(temp && "failed to grow archetype chunk list!");
+			archetype->chunks = temp;
+		}
+		uint8_t* block = aligned_alloc(COLUMN_ALIGN, ARCHETYPE_CHUNK_SIZE);
+		assert(block && "failed to allocate archetype chunk!");
+		archetype->chunks[archetype->num_chunks++] = block;
+	}
+	entity_column(archetype, chunk)[row % archetype->chunk_cap] = id;
+	++archetype->size;
+	return row;
+}
+
+// move the last row into the hole, returns the id of the moved entity or -1
+static int32_t archetype_swap_remove(archetype_t* archetype, const int32_t row)
+{
+	const int32_t last = --archetype->size;
+	if (row == last)
+	{
+		return -1;
+	}
+	const int32_t cap = archetype->chunk_cap;
+	const int32_t dst_chunk = row / cap, dst = row % cap;
+	const int32_t src_chunk = last / cap, src = last % cap;
+	for (int32_t c = 0; c < NUM_COMPONENTS; ++c)
+	{
+		if (archetype->offsets[c] >= 0)
+		{
+			const int32_t size = component_sizes[c];
+			memcpy((uint8_t*)column(archetype, dst_chunk, c) + dst * size, (uint8_t*)column(archetype, src_chunk, c) + src * size, size);
+		}
+	}
+	const int32_t id = entity_column(archetype, src_chunk)[src];
+	entity_column(archetype, dst_chunk)[dst] = id;
+	return id;
+}
+
+void ecs_world_init(ecs_world_t* world, const int32_t capacity)
+{
+	memset(world, 0x00, sizeof *world);
+	world->archetypes_cap = 16;
+	world->archetypes = malloc(world->archetypes_cap * sizeof *world->archetypes);
+	world->lookup_cap = 32;
+	world->lookup = calloc(world->lookup_cap, sizeof *world->lookup);
+	world->records_cap = capacity > 0 ? capacity : 1;
+	world->records = malloc(world->records_cap * sizeof *world->records);
+	world->free_ids = malloc(world->records_cap * sizeof *world->free_ids);
+	world->dead_cap = world->records_cap;
+	world->dead = malloc(world->dead_cap * sizeof *world->dead);
+	assert(world->archetypes && world->lookup && world->records && world->free_ids && world->dead && "failed to allocate world!");
+	// the empty archetype is always index 0
+	find_archetype(world, SIGNATURE_EMPTY);
+}
+
+void ecs_world_destroy(ecs_world_t* world)
+{
+	for (int32_t i = 0; i < world->num_archetypes; ++i)
+	{
+		archetype_t* archetype = world->archetypes + i;
+		for (int32_t j = 0; j < archetype->num_chunks; ++j)
+		{
+			free(archetype->chunks[j]);
+		}
+		free(archetype->chunks);
+	}
+	free(world->archetypes);
+	free(world->lookup);
+	free(world->records);
+	free(world->free_ids);
+	free(world->dead);
+	memset(world, 0x00, sizeof *world);
+}
+
+void ecs_world_clear(ecs_world_t* world)
+{
+	for (int32_t i = 0; i < world->num_archetypes; ++i)
+	{
+		world->archetypes[i].size = 0;
+	}
+	world->next_id = 0;
+	world->num_free_ids = 0;
+	world->num_dead = 0;
+	world->size = 0;
+}
+
+int32_t ecs_world_create_entity(ecs_world_t* world)
+{
+	int32_t id;
+	if (world->num_free_ids > 0)
+	{
+		id = world->free_ids[--world->num_free_ids];
+	}
+	else
+	{
+		if (world->next_id == world->records_cap)
+		{
+			world->records_cap *= 2;
+			ecs_record_t* records = realloc(world->records, world->records_cap * sizeof *records);
+			int32_t* free_ids = realloc(world->free_ids, world->records_cap * sizeof *free_ids);
+			assert(records && free_ids && "failed to grow entity records!");
+			world->records = records;
+			world->free_ids = free_ids;
+		}
+		id = world->next_id++;
+	}
+	world->records[id].archetype = 0;
+	world->records[id].row = archetype_push(world->archetypes, id);
+	++world->size;
+	return id;
+}
+
+void ecs_world_destroy_entity(ecs_world_t* world, const int32_t id)
+{
+	const ecs_record_t record = world->records[id];
+	const int32_t moved = archetype_swap_remove(world->archetypes + record.archetype, record.row);
+	if (moved >= 0)
+	{
+		world->records[moved].row = record.row;
+	}
+	world->free_ids[world->num_free_ids++] = id;
+	--world->size;
+}
+
+void ecs_world_add_component(ecs_world_t* world, const int32_t id, const component_t component)
+{
+	const ecs_record_t record = world->records[id];
+	archetype_t* src = world->archetypes + record.archetype;
+	if (signature_test(src->mask, component))
+	{
+		return;
+	}
+	int32_t dst_index = src->add_edges[component];
+	if (dst_index < 0)
+	{
+		dst_index = find_archetype(world, signature_or(src->mask, SIGNATURE(component)));
+		// find_archetype may realloc the archetypes
+		src = world->archetypes + record.archetype;
+		src->add_edges[component] = dst_index;
+	}
+	archetype_t* dst = world->archetypes + dst_index;
+	const int32_t row = archetype_push(dst, id);
+	const int32_t src_chunk = record.row / src->chunk_cap, src_row = record.row % src->chunk_cap;
+	const int32_t dst_chunk = row / dst->chunk_cap, dst_row = row % dst->chunk_cap;
+	for (int32_t c = 0; c < NUM_COMPONENTS; ++c)
+	{
+		if (dst->offsets[c] < 0)
+		{
+			continue;
+		}
+		const int32_t size = component_sizes[c];
+		uint8_t* to = (uint8_t*)column(dst, dst_chunk, c) + dst_row * size;
+		if (src->offsets[c] >= 0)
+		{
+			memcpy(to, (uint8_t*)column(src, src_chunk, c) + src_row * size, size);
+		}
+		else
+		{
+			memset(to, 0x00, size);
+		}
+	}
+	const int32_t moved = archetype_swap_remove(src, record.row);
+	if (moved >= 0)
+	{
+		world->records[moved].row = record.row;
+	}
+	world->records[id].archetype = dst_index;
+	world->records[id].row = row;
+}
+
+#define X(ENUM, NAME) void ecs_world_set_##NAME(ecs_world_t* world, const int32_t id, const NAME##_t* value) \
+{ \
+	const ecs_record_t record = world->records[id]; \
+	const archetype_t* archetype = world->archetypes + record.archetype; \
+	assert(archetype->offsets[ENUM] >= 0 && "entity doesn't have " #NAME "!"); \
+	NAME##_t* values = column(archetype, record.row / archetype->chunk_cap, ENUM); \
+	values[record.row % archetype->chunk_cap] = *value; \
+}
+COMPONENTS
+#undef X
+
+static void destroy_dead_entities(ecs_world_t* world)
+{
+	PROFILE_PHASE_BEGIN(PROFILE_DESTROY);
+	PROFILE_DESTROYED(world->num_dead);
+	for (int32_t i = 0; i < world->num_dead; ++i)
+	{
+		ecs_world_destroy_entity(world, world->dead[i]);
+	}
+	PROFILE_PHASE_END(PROFILE_DESTROY, world->num_dead);
+	world->num_dead = 0;
+	if (world->dead_cap < world->size)
+	{
+		free(world->dead);
+		while (world->dead_cap < world->size)
+		{
+			world->dead_cap *= 2;
+		}
+		world->dead = malloc(world->dead_cap * sizeof *world->dead);
+		assert(world->dead && "failed to grow dead list!");
+	}
+}
+
+// entities in the archetypes that have all of mask
+inline static int32_t matching_size(const ecs_world_t* world, const signature_t mask)
+{
+	int32_t n = 0;
+	for (int32_t a = 0; a < world->num_archetypes; ++a)
+	{
+		n += signature_has(world->archetypes[a].mask, mask) ? world->archetypes[a].size : 0;
+	}
+	return n;
+}
+
+inline static void move_chunk(archetype_t* archetype, const int32_t chunk, const float delta)
+{
+	const int32_t n = chunk_rows(archetype, chunk);
+	simd_move(column(archetype, chunk, POSITION), column(archetype, chunk, VELOCITY), n, delta);
+}
+
+int32_t archetype_single_thread_tick(ecs_world_t* world, const float delta)
+{
+	PROFILE_TICK_BEGIN(__func__);
+	destroy_dead_entities(world);
+	const signature_t pos_mask = SIGNATURE(POSITION, VELOCITY);
+	const signature_t l_mask = SIGNATURE(LIFETIME);
+	PROFILE_PHASE_BEGIN(PROFILE_MOVEMENT);
+	for (int32_t a = 0; a < world->num_archetypes; ++a)
+	{
+		archetype_t* archetype = world->archetypes + a;
+		if (!signature_has(archetype->mask, pos_mask))
+		{
+			continue;
+		}
+		const int32_t num_chunks = used_chunks(archetype);
+		for (int32_t c = 0; c < num_chunks; ++c)
+		{
+			move_chunk(archetype, c, delta);
+		}
+	}
+	PROFILE_PHASE_END(PROFILE_MOVEMENT, matching_size(world, pos_mask));
+	PROFILE_PHASE_BEGIN(PROFILE_LIFETIME);
+	for (int32_t a = 0; a < world->num_archetypes; ++a)
+	{
+		archetype_t* archetype = world->archetypes + a;
+		if (!signature_has(archetype->mask, l_mask))
+		{
+			continue;
+		}
+		const int32_t num_chunks = used_chunks(archetype);
+		for (int32_t c = 0; c < num_chunks; ++c)
+		{
+			const int32_t n = chunk_rows(archetype, c);
+			lifetime_t* restrict lifetimes = column(archetype, c, LIFETIME);
+			const int32_t* restrict ids = entity_column(archetype, c);
+			simd_decay(lifetimes, NULL, n, delta);
+			for (int32_t i = 0; i < n; ++i)
+			{
+				if (lifetimes[i].bits >> 31)
+				{
+					world->dead[world->num_dead++] = ids[i];
+				}
+			}
+		}
+	}
+	PROFILE_PHASE_END(PROFILE_LIFETIME, matching_size(world, l_mask));
+	PROFILE_TICK_END();
+	return world->size;
+}
+
+int32_t archetype_openmp_tick(ecs_world_t* world, const float delta)
+{
+	numa_pin_openmp();
+	PROFILE_TICK_BEGIN(__func__);
+	destroy_dead_entities(world);
+	const signature_t pos_mask = SIGNATURE(POSITION, VELOCITY);
+	const signature_t l_mask = SIGNATURE(LIFETIME);
+	PROFILE_PHASE_BEGIN(PROFILE_MOVEMENT);
+	for (int32_t a = 0; a < world->num_archetypes; ++a)
+	{
+		archetype_t* archetype = world->archetypes + a;
+		if (!signature_has(archetype->mask, pos_mask))
+		{
+			continue;
+		}
+		const int32_t num_chunks = used_chunks(archetype);
+#pragma omp parallel for
+		for (int32_t c = 0; c < num_chunks; ++c)
+		{
+			move_chunk(archetype, c, delta);
+		}
+	}
+	PROFILE_PHASE_END(PROFILE_MOVEMENT, matching_size(world, pos_mask));
+	PROFILE_PHASE_BEGIN(PROFILE_LIFETIME);
+	int32_t* dead = world->dead;
+	int32_t num_dead = 0;
+	for (int32_t a = 0; a < world->num_archetypes; ++a)
+	{
+		archetype_t* archetype = world->archetypes + a;
+		if (!signature_has(archetype->mask, l_mask))
+		{
+			continue;
+		}
+		const int32_t num_chunks = used_chunks(archetype);
+#pragma omp parallel for
+		for (int32_t c = 0; c < num_chunks; ++c)
+		{
+			const int32_t n = chunk_rows(archetype, c);
+			lifetime_t* restrict lifetimes = column(archetype, c, LIFETIME);
+			const int32_t* restrict ids = entity_column(archetype, c);
+			simd_decay(lifetimes, NULL, n, delta);
+			for (int32_t i = 0; i < n; ++i)
+			{
+				if (lifetimes[i].bits >> 31)
+				{
+					int32_t k;
+#pragma omp atomic capture
+					k = num_dead++;
+					dead[k] = ids[i];
+				}
+			}
+		}
+	}
+	world->num_dead = num_dead;
+	PROFILE_PHASE_END(PROFILE_LIFETIME, matching_size(world, l_mask));
+	PROFILE_TICK_END();
+	return world->size;
+}
@@ -0,0 +1,71 @@
+#ifndef ARCHETYPE_H
+#define ARCHETYPE_H
+
+#include <stdint.h>
+#include "ecs.h"
+
+#define ARCHETYPE_CHUNK_SIZE (16 * 1024)
+
+// all entities with the same component mask live in the same archetype.  An archetype
+// stores its rows in fixed size chunks, each chunk holding one SoA column per component
+// plus the owning entity ids.  Rows are dense: every chunk is full except the last one.
+typedef struct archetype_t
+{
+	signature_t mask;
+	int32_t chunk_cap; // rows per chunk
+	int32_t entity_offset;
+	int32_t offsets[NUM_COMPONENTS]; // column offset inside a chunk, -1 if absent
+	int32_t add_edges[NUM_COMPONENTS]; // archetype index after adding a component, -1 if unknown
+	uint8_t** chunks;
+	int32_t num_chunks; // allocated, not necessarily in use
+	int32_t chunks_cap;
+	int32_t size;
+} archetype_t;
+
+typedef struct ecs_record_t
+{
+	int32_t archetype;
+	int32_t row;
+} ecs_record_t;
+
+typedef struct ecs_world_t
+{
+	archetype_t* archetypes;
+	int32_t num_archetypes;
+	int32_t archetypes_cap;
+	int32_t* lookup; // open addressing, mask -> archetype index + 1
+	int32_t lookup_cap;
+	ecs_record_t* records; // indexed by entity id
+	int32_t records_cap;
+	int32_t next_id;
+	int32_t* free_ids;
+	int32_t num_free_ids;
+	int32_t* dead; // flagged by the lifetime system, destroyed next tick
+	int32_t num_dead;
+	int32_t dead_cap;
+	int32_t size;
+} ecs_world_t;
+
+// capacity is just the initial size of the entity records, they grow as needed
+void ecs_world_init(ecs_world_t* world, const int32_t capacity);
+
+void ecs_world_destroy(ecs_world_t* world);
+
+// drop every entity but keep archetypes and their chunks around for reuse
+void ecs_world_clear(ecs_world_t* world);
+
+int32_t ecs_world_create_entity(ecs_world_t* world);
+
+void ecs_world_destroy_entity(ecs_world_t* world, const int32_t id);
+
+void ecs_world_add_component(ecs_world_t* world, const int32_t id, const component_t component);
+
+#define X(_, NAME) void ecs_world_set_##NAME(ecs_world_t* world, const int32_t id, const NAME##_t* value);
+COMPONENTS
+#undef X
+
+int32_t archetype_single_thread_tick(ecs_world_t* world, const float delta);
+
+int32_t archetype_openmp_tick(ecs_world_t* world, const float delta);
+
+#endif /* End ARCHETYPE_H */
@@ -0,0 +1,849 @@
+// benchmark driver.  Every variant runs warmup untimed ticks to fill the table, then
+// trials x ticks timed ticks.  A tick sample covers that tick's spawns plus the tick itself.
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <omp.h>
+#include "../ecs.h"
+#include "../soa.h"
+#include "../archetype.h"
+#include "../simd.h"
+#include "../systems.h"
+#include "../commands.h"
+#include "../workers.h"
+#include "../numa.h"
+#include "../allocators/vmem.h"
+#include "perf.h"
+
+static const float delta = 0.001f; // 100hz
+static const float lifetime0 = 3.0f;
+static const position_t position0 = {0};
+static const velocity_t velocity0 =
+{
+	.x = 10.0f
+};
+
+typedef enum storage_t
+{
+	STORAGE_TABLE,
+	STORAGE_SOA,
+	STORAGE_WORLD,
+} storage_t;
+
+typedef struct bench_ctx_t
+{
+	ecs_table_t table;
+	ecs_soa_table_t soa;
+	ecs_world_t world;
+	ecs_query_t* movers;
+	ecs_query_t* agers;
+	ecs_systems_t systems;
+	ecs_commands_t commands;
+	int32_t num_threads;
+} bench_ctx_t;
+
+typedef struct variant_t
+{
+	const char* name;
+	storage_t storage;
+	void (*spawn)(bench_ctx_t* ctx, const int32_t count);
+	int32_t (*tick)(bench_ctx_t* ctx);
+	int32_t threaded; // 0 if the thread count makes no difference
+	void (*setup)(bench_ctx_t* ctx); // may be NULL
+	void (*teardown)(bench_ctx_t* ctx); // may be NULL
+} variant_t;
+
+static const void* projectile[NUM_COMPONENTS] =
+{
+	[POSITION] = &position0,
+	[VELOCITY] = &velocity0,
+	[LIFETIME] = &lifetime0,
+};
+
+// spawners, same as main
+static void spawn_table(bench_ctx_t* ctx, const int32_t count)
+{
+	for (int32_t k = 0; k < count; ++k)
+	{
+		const int32_t id = ecs_activate_entity(&ctx->table);
+		ecs_add_component(&ctx->table, id, POSITION);
+		ecs_add_component(&ctx->table, id, VELOCITY);
+		ecs_add_component(&ctx->table, id, LIFETIME);
+		ecs_set_position(&ctx->table, id, &position0);
+		ecs_set_velocity(&ctx->table, id, &velocity0);
+		ecs_set_lifetime(&ctx->table, id, (const lifetime_t*)&lifetime0);
+	}
+}
+
+static void spawn_table_batch(bench_ctx_t* ctx, const int32_t count)
+{
+	ecs_spawn_batch(&ctx->table, count, SIGNATURE(POSITION, VELOCITY, LIFETIME), projectile);
+}
+
+static void spawn_commands(bench_ctx_t* ctx, const int32_t count)
+{
+	for (int32_t k = 0; k < count; ++k)
+	{
+		ecs_commands_spawn(&ctx->commands, 0, SIGNATURE(POSITION, VELOCITY, LIFETIME), projectile);
+	}
+}
+
+static void spawn_soa(bench_ctx_t* ctx, const int32_t count)
+{
+	for (int32_t k = 0; k < count; ++k)
+	{
+		const int32_t id = ecs_soa_activate_entity(&ctx->soa);
+		ecs_soa_add_component(&ctx->soa, id, POSITION);
+		ecs_soa_add_component(&ctx->soa, id, VELOCITY);
+		ecs_soa_add_component(&ctx->soa, id, LIFETIME);
+		ecs_soa_set_position(&ctx->soa, id, &position0);
+		ecs_soa_set_velocity(&ctx->soa, id, &velocity0);
+		ecs_soa_set_lifetime(&ctx->soa, id, (const lifetime_t*)&lifetime0);
+	}
+}
+
+static void spawn_soa_batch(bench_ctx_t* ctx, const int32_t count)
+{
+	ecs_soa_spawn_batch(&ctx->soa, count, SIGNATURE(POSITION, VELOCITY, LIFETIME), projectile);
+}
+
+static void spawn_world(bench_ctx_t* ctx, const int32_t count)
+{
+	for (int32_t k = 0; k < count; ++k)
+	{
+		const int32_t id = ecs_world_create_entity(&ctx->world);
+		ecs_world_add_component(&ctx->world, id, POSITION);
+		ecs_world_add_component(&ctx->world, id, VELOCITY);
+		ecs_world_add_component(&ctx->world, id, LIFETIME);
+		ecs_world_set_position(&ctx->world, id, &position0);
+		ecs_world_set_velocity(&ctx->world, id, &velocity0);
+		ecs_world_set_lifetime(&ctx->world, id, (const lifetime_t*)&lifetime0);
+	}
+}
+
+// system kernels for the systems variants
+static void move_system(ecs_table_t* ecs_table, const int32_t i0, const int32_t i1, const float delta, void* ctx)
+{
+	(void)ctx;
+	const signature_t mask = SIGNATURE(POSITION, VELOCITY);
+	for (int32_t i = i0; i < i1; ++i)
+	{
+		if (signature_has(ecs_table->bitmasks[i], mask))
+		{
+			position_t* position = ecs_table->components[i * NUM_COMPONENTS + POSITION];
+			const velocity_t* velocity = ecs_table->components[i * NUM_COMPONENTS + VELOCITY];
+			position->x += velocity->x * delta;
+			position->y += velocity->y * delta;
+			position->z += velocity->z * delta;
+		}
+	}
+}
+
+static void lifetime_system(ecs_table_t* ecs_table, const int32_t i0, const int32_t i1, const float delta, void* ctx)
+{
+	ecs_commands_t* commands = ctx;
+	const int32_t thread = workers_index();
+	const signature_t mask = SIGNATURE(LIFETIME);
+	for (int32_t i = i0; i < i1; ++i)
+	{
+		if (signature_has(ecs_table->bitmasks[i], mask))
+		{
+			lifetime_t* lifetime = ecs_table->components[i * NUM_COMPONENTS + LIFETIME];
+			lifetime->value -= delta;
+			if (!commands)
+			{
+				signature_flag(ecs_table->bitmasks + i, FREE_ENTITY, lifetime->bits >> 31);
+			}
+			else if (lifetime->bits >> 31)
+			{
+				ecs_commands_destroy_entity(commands, thread, ecs_entity_handle(ecs_table, i));
+			}
+		}
+	}
+}
+
+static void setup_query(bench_ctx_t* ctx)
+{
+	ctx->movers = ecs_query_create(&ctx->table, SIGNATURE(POSITION, VELOCITY), SIGNATURE_EMPTY);
+	ctx->agers = ecs_query_create(&ctx->table, SIGNATURE(LIFETIME), SIGNATURE_EMPTY);
+}
+
+static void teardown_query(bench_ctx_t* ctx)
+{
+	ecs_query_destroy(&ctx->table, ctx->movers);
+	ecs_query_destroy(&ctx->table, ctx->agers);
+}
+
+static void setup_systems(bench_ctx_t* ctx)
+{
+	ecs_systems_init(&ctx->systems);
+	ecs_system_register(&ctx->systems, "move", move_system, NULL, SIGNATURE(POSITION, VELOCITY), SIGNATURE(POSITION), 4096);
+	ecs_system_register(&ctx->systems, "lifetime", lifetime_system, NULL, SIGNATURE(LIFETIME), SIGNATURE(LIFETIME, FREE_ENTITY), 4096);
+}
+
+static void setup_commands(bench_ctx_t* ctx)
+{
+	ecs_commands_init(&ctx->commands);
+	ecs_systems_init(&ctx->systems);
+	ecs_system_register(&ctx->systems, "move", move_system, NULL, SIGNATURE(POSITION, VELOCITY), SIGNATURE(POSITION), 4096);
+	ecs_system_register(&ctx->systems, "lifetime", lifetime_system, &ctx->commands, SIGNATURE(LIFETIME), SIGNATURE(LIFETIME), 4096);
+}
+
+static void teardown_commands(bench_ctx_t* ctx)
+{
+	ecs_commands_destroy(&ctx->commands);
+}
+
+#define TABLE_TICK(NAME, CALL) \
+static int32_t tick_##NAME(bench_ctx_t* ctx) \
+{ \
+	ecs_table_t* ecs_table = &ctx->table; \
+	const int32_t num_threads = ctx->num_threads; \
+	(void)num_threads; \
+	return CALL; \
+}
+TABLE_TICK(single, single_thread_tick(ecs_table, delta))
+TABLE_TICK(alt, single_thread_tick_alt(ecs_table, delta))
+TABLE_TICK(fused, single_thread_tick_fused(ecs_table, delta))
+TABLE_TICK(query, single_thread_tick_query(ecs_table, ctx->movers, ctx->agers, delta))
+TABLE_TICK(mt1, multi_thread_tick(ecs_table, delta, num_threads))
+TABLE_TICK(mt2, multi_thread_tick2(ecs_table, delta, num_threads))
+TABLE_TICK(pthread, multi_pthread_tick(ecs_table, delta, num_threads))
+TABLE_TICK(alt_mt, multi_thread_tick_alt(ecs_table, delta, num_threads))
+TABLE_TICK(other_alt_mt, multi_thread_tick_other_alt(ecs_table, delta, num_threads))
+TABLE_TICK(workers, multi_thread_tick_workers(ecs_table, delta, num_threads))
+TABLE_TICK(mt2_workers, multi_thread_tick2_workers(ecs_table, delta, num_threads))
+TABLE_TICK(alt_workers, multi_thread_tick_alt_workers(ecs_table, delta, num_threads))
+TABLE_TICK(other_alt_workers, multi_thread_tick_other_alt_workers(ecs_table, delta, num_threads))
+TABLE_TICK(stealing, multi_thread_tick_stealing(ecs_table, delta, num_threads))
+TABLE_TICK(openmp, openmp_tick(ecs_table, delta))
+TABLE_TICK(systems, ecs_systems_tick(&ctx->systems, ecs_table, delta, num_threads))
+TABLE_TICK(commands, (ecs_commands_playback(&ctx->commands, ecs_table), ecs_systems_tick(&ctx->systems, ecs_table, delta, num_threads)))
+#undef TABLE_TICK
+
+static int32_t tick_soa(bench_ctx_t* ctx)
+{
+	return soa_single_thread_tick(&ctx->soa, delta);
+}
+
+static int32_t tick_soa_openmp(bench_ctx_t* ctx)
+{
+	return soa_openmp_tick(&ctx->soa, delta);
+}
+
+static int32_t tick_archetype(bench_ctx_t* ctx)
+{
+	return archetype_single_thread_tick(&ctx->world, delta);
+}
+
+static int32_t tick_archetype_openmp(bench_ctx_t* ctx)
+{
+	return archetype_openmp_tick(&ctx->world, delta);
+}
+
+static const variant_t variants[] =
+{
+	{ "single", STORAGE_TABLE, spawn_table, tick_single, 0, NULL, NULL },
+	{ "alt", STORAGE_TABLE, spawn_table, tick_alt, 0, NULL, NULL },
+	{ "fused", STORAGE_TABLE, spawn_table, tick_fused, 0, NULL, NULL },
+	{ "query", STORAGE_TABLE, spawn_table, tick_query, 0, setup_query, teardown_query },
+	{ "mt1", STORAGE_TABLE, spawn_table, tick_mt1, 1, NULL, NULL },
+	{ "mt2", STORAGE_TABLE, spawn_table, tick_mt2, 1, NULL, NULL },
+	{ "pthread", STORAGE_TABLE, spawn_table, tick_pthread, 1, NULL, NULL },
+	{ "alt_mt", STORAGE_TABLE, spawn_table, tick_alt_mt, 1, NULL, NULL },
+	{ "other_alt_mt", STORAGE_TABLE, spawn_table, tick_other_alt_mt, 1, NULL, NULL },
+	{ "workers", STORAGE_TABLE, spawn_table, tick_workers, 1, NULL, NULL },
+	{ "mt2_workers", STORAGE_TABLE, spawn_table, tick_mt2_workers, 1, NULL, NULL },
+	{ "alt_workers", STORAGE_TABLE, spawn_table, tick_alt_workers, 1, NULL, NULL },
+	{ "other_alt_workers", STORAGE_TABLE, spawn_table, tick_other_alt_workers, 1, NULL, NULL },
+	{ "stealing", STORAGE_TABLE, spawn_table, tick_stealing, 1, NULL, NULL },
+	{ "openmp", STORAGE_TABLE, spawn_table, tick_openmp, 1, NULL, NULL },
+	{ "openmp_batch", STORAGE_TABLE, spawn_table_batch, tick_openmp, 1, NULL, NULL },
+	{ "systems", STORAGE_TABLE, spawn_table, tick_systems, 1, setup_systems, NULL },
+	{ "commands", STORAGE_TABLE, spawn_commands, tick_commands, 1, setup_commands, teardown_commands },
+	{ "soa", STORAGE_SOA, spawn_soa, tick_soa, 0, NULL, NULL },
+	{ "soa_openmp", STORAGE_SOA, spawn_soa, tick_soa_openmp, 1, NULL, NULL },
+	{ "soa_batch", STORAGE_SOA, spawn_soa_batch, tick_soa_openmp, 1, NULL, NULL },
+	{ "archetype", STORAGE_WORLD, spawn_world, tick_archetype, 0, NULL, NULL },
+	{ "archetype_openmp", STORAGE_WORLD, spawn_world, tick_archetype_openmp, 1, NULL, NULL },
+};
+#define NUM_VARIANTS ((int32_t)(sizeof variants / sizeof *variants))
+
+typedef struct bench_config_t
+{
+	int32_t entities;
+	int32_t ticks;
+	int32_t warmup;
+	int32_t trials;
+	int32_t threads;
+	float spawn_rate; // entities per tick, < 0 derives it from entities
+	int32_t json;
+	int32_t table; // sweep only, human readable grids instead of rows
+	int32_t perf; // hardware counters around the timed ticks
+} bench_config_t;
+
+typedef struct bench_result_t
+{
+	const char* name;
+	double mean;
+	uint64_t median;
+	uint64_t p99;
+	uint64_t min;
+	uint64_t max;
+	int32_t size; // after the last trial
+	perf_counts_t counts; // over every timed tick, only with config perf
+	int64_t entity_ticks; // live entities summed over every timed tick
+} bench_result_t;
+
+inline static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void reset_storage(bench_ctx_t* ctx, const storage_t storage)
+{
+	switch (storage)
+	{
+	case STORAGE_TABLE:
+		ecs_table_clear(&ctx->table);
+		ecs_free_all();
+		break;
+	case STORAGE_SOA:
+		ctx->soa.size = 0;
+		break;
+	case STORAGE_WORLD:
+		ecs_world_clear(&ctx->world);
+		break;
+	}
+}
+
+static int compare_u64(const void* a, const void* b)
+{
+	const uint64_t x = *(const uint64_t*)a;
+	const uint64_t y = *(const uint64_t*)b;
+	return (x > y) - (x < y);
+}
+
+// nearest rank
+inline static uint64_t percentile(const uint64_t* sorted, const int64_t n, const double p)
+{
+	int64_t rank = (int64_t)(p * n + 0.999999);
+	rank = rank < 1 ? 1 : rank;
+	return sorted[(rank < n ? rank : n) - 1];
+}
+
+static bench_result_t run_variant(bench_ctx_t* ctx, const variant_t* variant, const bench_config_t* config, uint64_t* samples)
+{
+	if (variant->setup)
+	{
+		variant->setup(ctx);
+	}
+	int32_t size = 0;
+	perf_counts_t counts = {0};
+	int64_t entity_ticks = 0;
+	for (int32_t trial = 0; trial < config->trials; ++trial)
+	{
+		reset_storage(ctx, variant->storage);
+		int32_t num_active = 0;
+		float budget = 0.0f;
+		for (int32_t i = 0; i < config->warmup + config->ticks; ++i)
+		{
+			// after the warmup so every worker the variant uses exists already
+			if (config->perf && i == config->warmup)
+			{
+				perf_start();
+			}
+			const uint64_t start = now_ns();
+			budget += config->spawn_rate;
+			int32_t burst = (int32_t)budget;
+			burst = num_active + burst < config->entities ? burst : config->entities - num_active;
+			budget -= burst;
+			variant->spawn(ctx, burst);
+			num_active = variant->tick(ctx);
+			const uint64_t end = now_ns();
+			if (i >= config->warmup)
+			{
+				samples[(int64_t)trial * config->ticks + i - config->warmup] = end - start;
+				entity_ticks += num_active;
+			}
+		}
+		if (config->perf)
+		{
+			const perf_counts_t trial_counts = perf_stop();
+			for (int32_t c = 0; c < NUM_PERF_COUNTERS; ++c)
+			{
+				counts.values[c] = trial_counts.values[c] < 0 || counts.values[c] < 0 ? -1 : counts.values[c] + trial_counts.values[c];
+			}
+		}
+		size = num_active;
+	}
+	reset_storage(ctx, variant->storage);
+	if (variant->teardown)
+	{
+		variant->teardown(ctx);
+	}
+	const int64_t n = (int64_t)config->trials * config->ticks;
+	double total = 0.0;
+	for (int64_t k = 0; k < n; ++k)
+	{
+		total += samples[k];
+	}
+	qsort(samples, n, sizeof *samples, compare_u64);
+	return (bench_result_t){
+		.name = variant->name,
+		.mean = total / n,
+		.median = percentile(samples, n, 0.5),
+		.p99 = percentile(samples, n, 0.99),
+		.min = samples[0],
+		.max = samples[n - 1],
+		.size = size,
+		.counts = counts,
+		.entity_ticks = entity_ticks,
+	};
+}
+
+// counters per live entity per tick plus ipc, appended to a row
+static void print_perf_header(const bench_config_t* config)
+{
+	if (!config->perf)
+	{
+		return;
+	}
+	for (int32_t c = 0; c < NUM_PERF_COUNTERS; ++c)
+	{
+		printf(",%s_per_entity", perf_counter_name(c));
+	}
+	printf(",ipc");
+}
+
+static void print_perf(const bench_config_t* config, const bench_result_t* result)
+{
+	if (!config->perf)
+	{
+		return;
+	}
+	const int64_t* values = result->counts.values;
+	const double entity_ticks = result->entity_ticks > 0 ? (double)result->entity_ticks : 1.0;
+	for (int32_t c = 0; c < NUM_PERF_COUNTERS; ++c)
+	{
+		if (config->json)
+		{
+			if (values[c] < 0)
+			{
+				printf(", \"%s_per_entity\": null", perf_counter_name(c));
+			}
+			else
+			{
+				printf(", \"%s_per_entity\": %.4f", perf_counter_name(c), values[c] / entity_ticks);
+			}
+		}
+		else if (values[c] >= 0)
+		{
+			printf(",%.4f", values[c] / entity_ticks);
+		}
+		else
+		{
+			printf(",");
+		}
+	}
+	const int32_t has_ipc = values[PERF_CYCLES] > 0 && values[PERF_INSTRUCTIONS] >= 0;
+	const double ipc = has_ipc ? (double)values[PERF_INSTRUCTIONS] / values[PERF_CYCLES] : 0.0;
+	if (config->json)
+	{
+		printf(has_ipc ? ", \"ipc\": %.3f" : ", \"ipc\": null", ipc);
+	}
+	else
+	{
+		printf(has_ipc ? ",%.3f" : ",", ipc);
+	}
+}
+
+static void print_header(const bench_config_t* config)
+{
+	if (config->json)
+	{
+		printf("{\n\t\"simd\": \"%s\",\n\t\"entities\": %d,\n\t\"ticks\": %d,\n\t\"warmup\": %d,\n\t\"trials\": %d,\n\t\"threads\": %d,\n\t\"spawn_rate\": %f,\n\t\"results\": [", simd_isa(), config->entities, config->ticks, config->warmup, config->trials, config->threads, config->spawn_rate);
+	}
+	else
+	{
+		printf("variant,simd,entities,ticks,warmup,trials,threads,spawn_rate,mean_ns,median_ns,p99_ns,min_ns,max_ns,size");
+		print_perf_header(config);
+		printf("\n");
+	}
+}
+
+static void print_result(const bench_config_t* config, const bench_result_t* result, const int32_t first)
+{
+	if (config->json)
+	{
+		printf("%s\n\t\t{ \"variant\": \"%s\", \"mean_ns\": %.1f, \"median_ns\": %" PRIu64 ", \"p99_ns\": %" PRIu64 ", \"min_ns\": %" PRIu64 ", \"max_ns\": %" PRIu64 ", \"size\": %d", first ? "" : ",", result->name, result->mean, result->median, result->p99, result->min, result->max, result->size);
+		print_perf(config, result);
+		printf(" }");
+	}
+	else
+	{
+		printf("%s,%s,%d,%d,%d,%d,%d,%f,%.1f,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%d", result->name, simd_isa(), config->entities, config->ticks, config->warmup, config->trials, config->threads, config->spawn_rate, result->mean, result->median, result->p99, result->min, result->max, result->size);
+		print_perf(config, result);
+		printf("\n");
+	}
+	fflush(stdout);
+}
+
+static void print_footer(const bench_config_t* config)
+{
+	if (config->json)
+	{
+		printf("\n\t]\n}\n");
+	}
+}
+
+#define MAX_SWEEP 64
+
+typedef struct sweep_point_t
+{
+	bench_result_t result;
+	int32_t threads;
+	double throughput; // entities per second
+	double speedup;
+	double efficiency;
+} sweep_point_t;
+
+// comma separated positive integers, returns how many or -1 if something doesn't parse
+static int32_t parse_list(char* list, int32_t* out, const int32_t max)
+{
+	int32_t n = 0;
+	for (char* item = strtok(list, ","); item; item = strtok(NULL, ","))
+	{
+		const int32_t value = atoi(item);
+		if (value <= 0 || n == max)
+		{
+			return -1;
+		}
+		out[n++] = value;
+	}
+	return n;
+}
+
+static void init_ctx(bench_ctx_t* ctx, const int32_t entities)
+{
+	ecs_table_init(&ctx->table, entities);
+	ecs_soa_init(&ctx->soa, entities);
+	ecs_world_init(&ctx->world, entities);
+}
+
+static void destroy_ctx(bench_ctx_t* ctx)
+{
+	ecs_world_destroy(&ctx->world);
+	ecs_soa_destroy(&ctx->soa);
+	ecs_table_destroy(&ctx->table);
+}
+
+static void set_threads(bench_ctx_t* ctx, bench_config_t* config, const int32_t threads)
+{
+	config->threads = threads;
+	ctx->num_threads = threads;
+	omp_set_num_threads(threads);
+}
+
+static void print_sweep_point(const bench_config_t* config, const char* name, const sweep_point_t* point, const int32_t first)
+{
+	const bench_result_t* result = &point->result;
+	if (config->json)
+	{
+		printf("%s\n\t\t{ \"variant\": \"%s\", \"entities\": %d, \"threads\": %d, \"mean_ns\": %.1f, \"median_ns\": %" PRIu64 ", \"p99_ns\": %" PRIu64 ", \"size\": %d, \"entities_per_s\": %.0f, \"speedup\": %.3f, \"efficiency\": %.3f", first ? "" : ",", name, config->entities, point->threads, result->mean, result->median, result->p99, result->size, point->throughput, point->speedup, point->efficiency);
+		print_perf(config, result);
+		printf(" }");
+	}
+	else
+	{
+		printf("%s,%s,%d,%d,%.1f,%" PRIu64 ",%" PRIu64 ",%d,%.0f,%.3f,%.3f", name, simd_isa(), config->entities, point->threads, result->mean, result->median, result->p99, result->size, point->throughput, point->speedup, point->efficiency);
+		print_perf(config, result);
+		printf("\n");
+	}
+	fflush(stdout);
+}
+
+// one grid per entity count, a row per variant and a column per thread count
+static void print_sweep_table(const bench_config_t* config, const variant_t* const* selected, const int32_t num_selected, const sweep_point_t (*points)[MAX_SWEEP], const int32_t* num_points, const int32_t* threads, const int32_t num_threads)
+{
+	printf("\n%d entities, median tick / entities per second / speedup (efficiency)\n", config->entities);
+	printf("%-18s", "variant");
+	for (int32_t t = 0; t < num_threads; ++t)
+	{
+		printf(" %28d", threads[t]);
+	}
+	printf("\n");
+	for (int32_t v = 0; v < num_selected; ++v)
+	{
+		printf("%-18s", selected[v]->name);
+		for (int32_t t = 0; t < num_points[v]; ++t)
+		{
+			const sweep_point_t* point = points[v] + t;
+			char cell[64];
+			snprintf(cell, sizeof cell, "%.1fus %.2e %.2fx (%3.0f%%)", point->result.median / 1e3, point->throughput, point->speedup, point->efficiency * 100.0);
+			printf(" %28s", cell);
+		}
+		printf("\n");
+	}
+	fflush(stdout);
+}
+
+static void run_sweep(bench_ctx_t* ctx, bench_config_t* config, const variant_t* const* selected, const int32_t num_selected, const int32_t* entities, const int32_t num_entities, const int32_t* threads, const int32_t num_threads, uint64_t* samples)
+{
+	static sweep_point_t points[sizeof variants / sizeof *variants][MAX_SWEEP];
+	int32_t num_points[sizeof variants / sizeof *variants];
+	const float spawn_rate = config->spawn_rate;
+	int32_t first = 1;
+	if (config->json)
+	{
+		printf("{\n\t\"simd\": \"%s\",\n\t\"ticks\": %d,\n\t\"warmup\": %d,\n\t\"trials\": %d,\n\t\"results\": [", simd_isa(), config->ticks, config->warmup, config->trials);
+	}
+	else if (!config->table)
+	{
+		printf("variant,simd,entities,threads,mean_ns,median_ns,p99_ns,size,entities_per_s,speedup,efficiency");
+		print_perf_header(config);
+		printf("\n");
+	}
+	for (int32_t e = 0; e < num_entities; ++e)
+	{
+		config->entities = entities[e];
+		config->spawn_rate = spawn_rate < 0.0f ? entities[e] * delta / lifetime0 : spawn_rate;
+		init_ctx(ctx, entities[e]);
+		for (int32_t v = 0; v < num_selected; ++v)
+		{
+			num_points[v] = 0;
+			for (int32_t t = 0; t < (selected[v]->threaded ? num_threads : 1); ++t)
+			{
+				fprintf(stderr, "running %s, %d entities, %d threads\n", selected[v]->name, entities[e], threads[t]);
+				set_threads(ctx, config, threads[t]);
+				sweep_point_t* point = points[v] + num_points[v]++;
+				point->result = run_variant(ctx, selected[v], config, samples);
+				point->threads = threads[t];
+				const double median = point->result.median > 0 ? (double)point->result.median : 1.0;
+				point->throughput = point->result.size / (median * 1e-9);
+				point->speedup = (double)points[v][0].result.median / median;
+				point->efficiency = point->speedup * threads[0] / threads[t];
+				if (!config->table)
+				{
+					print_sweep_point(config, selected[v]->name, point, first);
+					first = 0;
+				}
+			}
+		}
+		if (config->table)
+		{
+			print_sweep_table(config, selected, num_selected, points, num_points, threads, num_threads);
+		}
+		destroy_ctx(ctx);
+	}
+	print_footer(config);
+}
+
+static void usage(const char* argv0)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -n entities   most live entities, also the table capacity (default %d)\n"
+		"  -t ticks      timed ticks per trial (default 1000)\n"
+		"  -w ticks      untimed warmup ticks per trial (default 3000, enough to fill up)\n"
+		"  -r trials     (default 5)\n"
+		"  -j threads    (default: online cpus)\n"
+		"  -s rate       entities spawned per tick (default entities * %g / %g)\n"
+		"  -v a,b,...    variants to run (default all)\n"
+		"  -f csv|json   output format (default csv), sweeps also take table\n"
+		"  -p            count cycles, instructions, llc/branch/dtlb misses around the timed\n"
+		"                ticks and report them per live entity per tick (linux perf_event)\n"
+		"  -a            pin threads, thread i of n to node i * nodes / n (see numa.h)\n"
+		"  -H off|thp|explicit  huge pages for tables, pools and arenas (default thp)\n"
+		"  -l            list the variants\n"
+		"sweep mode, every variant at every entity count and thread count:\n"
+		"  -S            sweep instead of a single run, -n and -j are ignored\n"
+		"  -N a,b,...    entity counts (default 1000,10000,100000,1000000,10000000)\n"
+		"  -J a,b,...    thread counts (default 1,2,4,... up to online cpus)\n"
+		"speedup and efficiency are against the first thread count, variants that\n"
+		"don't use threads only run at that one\n",
+		argv0, ENTITY_CAP, delta, lifetime0);
+}
+
+static const variant_t* find_variant(const char* name)
+{
+	for (int32_t v = 0; v < NUM_VARIANTS; ++v)
+	{
+		if (strcmp(variants[v].name, name) == 0)
+		{
+			return variants + v;
+		}
+	}
+	return NULL;
+}
+
+int main(int argc, char** argv)
+{
+	bench_config_t config =
+	{
+		.entities = ENTITY_CAP,
+		.ticks = 1000,
+		.warmup = 3000,
+		.trials = 5,
+		.threads = sysconf(_SC_NPROCESSORS_ONLN),
+		.spawn_rate = -1.0f,
+	};
+	char* list = NULL;
+	char* entity_list = NULL;
+	char* thread_list = NULL;
+	int32_t sweep = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "n:t:w:r:j:s:v:f:palhSN:J:H:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n': config.entities = atoi(optarg); break;
+		case 't': config.ticks = atoi(optarg); break;
+		case 'w': config.warmup = atoi(optarg); break;
+		case 'r': config.trials = atoi(optarg); break;
+		case 'j': config.threads = atoi(optarg); break;
+		case 's': config.spawn_rate = atof(optarg); break;
+		case 'v': list = optarg; break;
+		case 'S': sweep = 1; break;
+		case 'p': config.perf = 1; break;
+		case 'a': numa_set_pinning(1); break;
+		case 'N': entity_list = optarg; break;
+		case 'J': thread_list = optarg; break;
+		case 'H':
+			// before the first table, that's when the pools get reserved
+			if (strcmp(optarg, "off") == 0) vmem_set_huge_pages(VMEM_HUGE_OFF);
+			else if (strcmp(optarg, "thp") == 0) vmem_set_huge_pages(VMEM_HUGE_TRANSPARENT);
+			else if (strcmp(optarg, "explicit") == 0) vmem_set_huge_pages(VMEM_HUGE_EXPLICIT);
+			else
+			{
+				fprintf(stderr, "unknown huge page mode '%s'\n", optarg);
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'f':
+			if (strcmp(optarg, "json") && strcmp(optarg, "csv") && strcmp(optarg, "table"))
+			{
+				usage(argv[0]);
+				return 1;
+			}
+			config.json = strcmp(optarg, "json") == 0;
+			config.table = strcmp(optarg, "table") == 0;
+			break;
+		case 'l':
+			for (int32_t v = 0; v < NUM_VARIANTS; ++v)
+			{
+				printf("%s\n", variants[v].name);
+			}
+			return 0;
+		default:
+			usage(argv[0]);
+			return opt != 'h';
+		}
+	}
+	if (config.entities <= 0 || config.entities > ECS_MAX_ENTITIES || config.ticks <= 0 || config.warmup < 0 || config.trials <= 0 || config.threads <= 0 || config.threads > ECS_MAX_THREADS)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+	// pick the variants before running anything so a typo fails fast
+	const variant_t* selected[NUM_VARIANTS];
+	int32_t num_selected = 0;
+	if (!list || strcmp(list, "all") == 0)
+	{
+		for (int32_t v = 0; v < NUM_VARIANTS; ++v)
+		{
+			selected[num_selected++] = variants + v;
+		}
+	}
+	else
+	{
+		for (char* name = strtok(list, ","); name; name = strtok(NULL, ","))
+		{
+			const variant_t* variant = find_variant(name);
+			if (!variant)
+			{
+				fprintf(stderr, "unknown variant: %s\n", name);
+				return 1;
+			}
+			if (num_selected < NUM_VARIANTS)
+			{
+				selected[num_selected++] = variant;
+			}
+		}
+	}
+	static bench_ctx_t ctx;
+	uint64_t* samples = malloc((size_t)config.trials * config.ticks * sizeof *samples);
+	if (!samples)
+	{
+		fprintf(stderr, "failed to allocate samples!\n");
+		return 1;
+	}
+	if (sweep)
+	{
+		int32_t entities[MAX_SWEEP] = { 1000, 10000, 100000, 1000000, 10000000 };
+		int32_t num_entities = 5;
+		int32_t threads[MAX_SWEEP];
+		int32_t num_threads = 0;
+		const int32_t nproc = sysconf(_SC_NPROCESSORS_ONLN);
+		for (int32_t t = 1; t < nproc && num_threads < MAX_SWEEP - 1; t *= 2)
+		{
+			threads[num_threads++] = t;
+		}
+		threads[num_threads++] = nproc;
+		if (entity_list)
+		{
+			num_entities = parse_list(entity_list, entities, MAX_SWEEP);
+		}
+		if (thread_list)
+		{
+			num_threads = parse_list(thread_list, threads, MAX_SWEEP);
+		}
+		int32_t ok = num_entities > 0 && num_threads > 0;
+		for (int32_t e = 0; ok && e < num_entities; ++e)
+		{
+			ok = entities[e] <= ECS_MAX_ENTITIES;
+		}
+		for (int32_t t = 0; ok && t < num_threads; ++t)
+		{
+			ok = threads[t] <= ECS_MAX_THREADS;
+		}
+		if (!ok)
+		{
+			usage(argv[0]);
+			return 1;
+		}
+		run_sweep(&ctx, &config, selected, num_selected, entities, num_entities, threads, num_threads, samples);
+		free(samples);
+		return 0;
+	}
+	if (config.table)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+	if (config.spawn_rate < 0.0f)
+	{
+		config.spawn_rate = config.entities * delta / lifetime0;
+	}
+	init_ctx(&ctx, config.entities);
+	set_threads(&ctx, &config, config.threads);
+	print_header(&config);
+	for (int32_t v = 0; v < num_selected; ++v)
+	{
+		fprintf(stderr, "running %s\n", selected[v]->name);
+		const bench_result_t result = run_variant(&ctx, selected[v], &config, samples);
+		print_result(&config, &result, v == 0);
+	}
+	print_footer(&config);
+	free(samples);
+	destroy_ctx(&ctx);
+	return 0;
+}
@@ -0,0 +1,156 @@
+#include "perf.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+// threads counted at once, more than that and the rest go uncounted
+#define PERF_MAX_TASKS 1024
+
+static const char* counter_names[NUM_PERF_COUNTERS] = {
+#define X(_, NAME) #NAME,
+	PERF_COUNTERS
+#undef X
+};
+
+static const struct
+{
+	uint32_t type;
+	uint64_t config;
+} counter_events[NUM_PERF_COUNTERS] = {
+	[PERF_CYCLES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	[PERF_INSTRUCTIONS] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	[PERF_LLC_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	[PERF_BRANCH_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	[PERF_DTLB_MISSES] = { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+};
+
+static struct
+{
+	int fds[PERF_MAX_TASKS][NUM_PERF_COUNTERS];
+	int32_t num_tasks;
+	int32_t warned;
+} perf = {0};
+
+const char* perf_counter_name(const perf_counter_t counter)
+{
+	return counter_names[counter];
+}
+
+static int open_counter(const perf_counter_t counter, const pid_t tid)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0x00, sizeof attr);
+	attr.size = sizeof attr;
+	attr.type = counter_events[counter].type;
+	attr.config = counter_events[counter].config;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	attr.disabled = 1;
+	// threads spawned from here on get folded in when they exit
+	attr.inherit = 1;
+	// user space only, that works with the default perf_event_paranoid
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0);
+}
+
+int32_t perf_start(void)
+{
+	perf.num_tasks = 0;
+	int32_t opened[NUM_PERF_COUNTERS] = {0};
+	int err = 0;
+	DIR* tasks = opendir("/proc/self/task");
+	if (!tasks)
+	{
+		fprintf(stderr, "failed to list threads, no perf counters!\n");
+		return 0;
+	}
+	for (struct dirent* entry; (entry = readdir(tasks)) && perf.num_tasks < PERF_MAX_TASKS;)
+	{
+		const pid_t tid = atoi(entry->d_name);
+		if (tid <= 0)
+		{
+			continue;
+		}
+		int* fds = perf.fds[perf.num_tasks++];
+		for (int32_t c = 0; c < NUM_PERF_COUNTERS; ++c)
+		{
+			fds[c] = open_counter(c, tid);
+			if (fds[c] < 0)
+			{
+				err = errno;
+			}
+			opened[c] += fds[c] >= 0;
+		}
+	}
+	closedir(tasks);
+	int32_t num_opened = 0;
+	for (int32_t c = 0; c < NUM_PERF_COUNTERS; ++c)
+	{
+		num_opened += opened[c] > 0;
+	}
+	if (num_opened < NUM_PERF_COUNTERS && !perf.warned)
+	{
+		fprintf(stderr, "only %d of %d perf counters available (%s), check perf_event_paranoid\n", num_opened, NUM_PERF_COUNTERS, strerror(err));
+		perf.warned = 1;
+	}
+	for (int32_t t = 0; t < perf.num_tasks; ++t)
+	{
+		for (int32_t c = 0; c < NUM_PERF_COUNTERS; ++c)
+		{
+			if (perf.fds[t][c] >= 0)
+			{
+				ioctl(perf.fds[t][c], PERF_EVENT_IOC_RESET, 0);
+				ioctl(perf.fds[t][c], PERF_EVENT_IOC_ENABLE, 0);
+			}
+		}
+	}
+	return num_opened;
+}
+
+perf_counts_t perf_stop(void)
+{
+	perf_counts_t counts;
+	int32_t opened[NUM_PERF_COUNTERS] = {0};
+	double totals[NUM_PERF_COUNTERS] = {0};
+	for (int32_t t = 0; t < perf.num_tasks; ++t)
+	{
+		for (int32_t c = 0; c < NUM_PERF_COUNTERS; ++c)
+		{
+			if (perf.fds[t][c] >= 0)
+			{
+				ioctl(perf.fds[t][c], PERF_EVENT_IOC_DISABLE, 0);
+			}
+		}
+	}
+	for (int32_t t = 0; t < perf.num_tasks; ++t)
+	{
+		for (int32_t c = 0; c < NUM_PERF_COUNTERS; ++c)
+		{
+			const int fd = perf.fds[t][c];
+			if (fd < 0)
+			{
+				continue;
+			}
+			// value, time enabled, time running
+			uint64_t data[3];
+			if (read(fd, data, sizeof data) == sizeof data)
+			{
+				opened[c] = 1;
+				totals[c] += data[2] > 0 ? (double)data[0] * data[1] / data[2] : 0.0;
+			}
+			close(fd);
+		}
+	}
+	perf.num_tasks = 0;
+	for (int32_t c = 0; c < NUM_PERF_COUNTERS; ++c)
+	{
+		counts.values[c] = opened[c] ? (int64_t)totals[c] : -1;
+	}
+	return counts;
+}
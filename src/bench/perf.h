@@ -0,0 +1,40 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+
+// hardware counters through perf_event_open, linux only.  Counting covers every thread of
+// the process that exists when counting starts, plus whatever threads those spawn once
+// they exit.  Pool threads created mid count aren't seen until shutdown, warm up first.
+
+#define PERF_COUNTERS \
+	X(PERF_CYCLES, cycles)	\
+	X(PERF_INSTRUCTIONS, instructions)	\
+	X(PERF_LLC_MISSES, llc_misses)	\
+	X(PERF_BRANCH_MISSES, branch_misses)	\
+	X(PERF_DTLB_MISSES, dtlb_misses)
+
+typedef enum perf_counter_t
+{
+#define X(ENUM, _) ENUM,
+	PERF_COUNTERS
+#undef X
+	NUM_PERF_COUNTERS
+} perf_counter_t;
+
+typedef struct perf_counts_t
+{
+	// scaled up if the kernel had to multiplex, -1 if the counter couldn't be opened
+	int64_t values[NUM_PERF_COUNTERS];
+} perf_counts_t;
+
+const char* perf_counter_name(const perf_counter_t counter);
+
+// opens the counters on every thread and starts them.  Returns how many counters could be
+// opened at all, complains once on stderr if that's fewer than all of them.
+int32_t perf_start(void);
+
+// stops, reads and closes the counters
+perf_counts_t perf_stop(void);
+
+#endif /* End PERF_H */
@@ -0,0 +1,305 @@
+#include "commands.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#define COMMANDS_MIN 64
+#define COMMAND_DATA_MIN 1024
+
+static const int32_t component_sizes[NUM_COMPONENTS] = {
+#define X(_, NAME) sizeof(NAME##_t),
+	COMPONENTS
+#undef X
+};
+
+// playback scratch, one key per command.  row or mask hash << 40 | thread << 32 | index
+static struct
+{
+	uint64_t* keys;
+	int32_t size;
+	int32_t cap;
+} sorted = {0};
+
+void ecs_commands_init(ecs_commands_t* commands)
+{
+	memset(commands, 0x00, sizeof *commands);
+}
+
+void ecs_commands_destroy(ecs_commands_t* commands)
+{
+	for (int32_t t = 0; t < ECS_MAX_THREADS; ++t)
+	{
+		free(commands->buffers[t].commands);
+		free(commands->buffers[t].data);
+	}
+	memset(commands, 0x00, sizeof *commands);
+}
+
+static ecs_command_t* push_command(ecs_commands_t* commands, const int32_t thread, const int32_t data_size)
+{
+	assert(thread >= 0 && thread < ECS_MAX_THREADS && "thread index out of range!");
+	ecs_command_buffer_t* buffer = commands->buffers + thread;
+	if (buffer->size == buffer->cap)
+	{
+		const int32_t cap = buffer->cap ? buffer->cap * 2 : COMMANDS_MIN;
+		ecs_command_t* temp = realloc(buffer->commands, cap * sizeof *temp);
+		assert(temp && "failed to grow command buffer!");
+		buffer->commands = temp;
+		buffer->cap = cap;
+	}
+	ecs_command_t* command = buffer->commands + buffer->size++;
+	command->offset = -1;
+	// spawns and destroys don't name one
+	command->component = 0;
+	if (data_size > 0)
+	{
+		if (buffer->data_size + data_size > buffer->data_cap)
+		{
+			int32_t cap = buffer->data_cap ? buffer->data_cap * 2 : COMMAND_DATA_MIN;
+			while (cap < buffer->data_size + data_size)
+			{
+				cap *= 2;
+			}
+			uint8_t* temp = realloc(buffer->data, cap);
+			assert(temp && "failed to grow command data!");
+			buffer->data = temp;
+			buffer->data_cap = cap;
+		}
+		command->offset = buffer->data_size;
+		buffer->data_size += data_size;
+	}
+	return command;
+}
+
+// value NULL means zeros
+inline static void write_value(uint8_t* dst, const component_t component, const void* value)
+{
+	if (value)
+	{
+		memcpy(dst, value, component_sizes[component]);
+	}
+	else
+	{
+		memset(dst, 0x00, component_sizes[component]);
+	}
+}
+
+void ecs_commands_spawn(ecs_commands_t* commands, const int32_t thread, const signature_t mask, const void* const* initializers)
+{
+	int32_t data_size = 0;
+	for (int32_t c = 0; c < NUM_COMPONENTS; ++c)
+	{
+		data_size += signature_test(mask, c) ? component_sizes[c] : 0;
+	}
+	ecs_command_t* command = push_command(commands, thread, data_size);
+	command->kind = COMMAND_SPAWN;
+	command->mask = mask;
+	// the values go in back to back, in component order
+	uint8_t* data = commands->buffers[thread].data + command->offset;
+	for (int32_t c = 0; c < NUM_COMPONENTS; ++c)
+	{
+		if (signature_test(mask, c))
+		{
+			write_value(data, c, initializers ? initializers[c] : NULL);
+			data += component_sizes[c];
+		}
+	}
+}
+
+void ecs_commands_destroy_entity(ecs_commands_t* commands, const int32_t thread, const entity_t entity)
+{
+	ecs_command_t* command = push_command(commands, thread, 0);
+	command->kind = COMMAND_DESTROY;
+	command->entity = entity;
+}
+
+void ecs_commands_add(ecs_commands_t* commands, const int32_t thread, const entity_t entity, const component_t component, const void* value)
+{
+	ecs_command_t* command = push_command(commands, thread, component_sizes[component]);
+	command->kind = COMMAND_ADD;
+	command->component = component;
+	command->entity = entity;
+	write_value(commands->buffers[thread].data + command->offset, component, value);
+}
+
+void ecs_commands_remove(ecs_commands_t* commands, const int32_t thread, const entity_t entity, const component_t component)
+{
+	ecs_command_t* command = push_command(commands, thread, 0);
+	command->kind = COMMAND_REMOVE;
+	command->component = component;
+	command->entity = entity;
+}
+
+void ecs_commands_set(ecs_commands_t* commands, const int32_t thread, const entity_t entity, const component_t component, const void* value)
+{
+	ecs_command_t* command = push_command(commands, thread, component_sizes[component]);
+	command->kind = COMMAND_SET;
+	command->component = component;
+	command->entity = entity;
+	write_value(commands->buffers[thread].data + command->offset, component, value);
+}
+
+static int compare_keys(const void* a, const void* b)
+{
+	const uint64_t x = *(const uint64_t*)a;
+	const uint64_t y = *(const uint64_t*)b;
+	return (x > y) - (x < y);
+}
+
+inline static uint64_t make_key(const uint32_t major, const int32_t thread, const int32_t index)
+{
+	return (uint64_t)(major & 0xffffff) << 40 | (uint64_t)thread << 32 | (uint32_t)index;
+}
+
+inline static const ecs_command_t* key_command(const ecs_commands_t* commands, const uint64_t key)
+{
+	return commands->buffers[(key >> 32) & 0xff].commands + (uint32_t)key;
+}
+
+inline static const uint8_t* key_data(const ecs_commands_t* commands, const uint64_t key)
+{
+	const ecs_command_t* command = key_command(commands, key);
+	return commands->buffers[(key >> 32) & 0xff].data + command->offset;
+}
+
+static void reserve_keys(const int32_t n)
+{
+	if (n > sorted.cap)
+	{
+		uint64_t* temp = realloc(sorted.keys, n * sizeof *temp);
+		assert(temp && "failed to grow playback keys!");
+		sorted.keys = temp;
+		sorted.cap = n;
+	}
+}
+
+// set/add/remove/destroy sorted by entity so every entity is visited once, in table order
+static void play_entity_commands(const ecs_commands_t* commands, ecs_table_t* ecs_table)
+{
+	int32_t destroyed = 0;
+	sorted.size = 0;
+	for (int32_t t = 0; t < ECS_MAX_THREADS; ++t)
+	{
+		const ecs_command_buffer_t* buffer = commands->buffers + t;
+		for (int32_t i = 0; i < buffer->size; ++i)
+		{
+			const ecs_command_t* command = buffer->commands + i;
+			if (command->kind == COMMAND_SPAWN)
+			{
+				continue;
+			}
+			const int32_t row = ecs_entity_index(ecs_table, command->entity);
+			if (row >= 0)
+			{
+				sorted.keys[sorted.size++] = make_key(row, t, i);
+			}
+		}
+	}
+	qsort(sorted.keys, sorted.size, sizeof *sorted.keys, compare_keys);
+	void** components = ecs_table->components;
+	for (int32_t k = 0; k < sorted.size; ++k)
+	{
+		const uint64_t key = sorted.keys[k];
+		const ecs_command_t* command = key_command(commands, key);
+		const int32_t row = key >> 40;
+		const component_t c = command->component;
+		switch (command->kind)
+		{
+		case COMMAND_ADD:
+			if (signature_test(ecs_table->bitmasks[row], c))
+			{
+				break;
+			}
+			ecs_add_component(ecs_table, row, c);
+			// fallthrough
+		case COMMAND_SET:
+			if (signature_test(ecs_table->bitmasks[row], c))
+			{
+				memcpy(components[row * NUM_COMPONENTS + c], key_data(commands, key), component_sizes[c]);
+			}
+			break;
+		case COMMAND_REMOVE:
+			if (signature_test(ecs_table->bitmasks[row], c))
+			{
+				ecs_remove_component(ecs_table, row, c);
+			}
+			break;
+		case COMMAND_DESTROY:
+			signature_flag(ecs_table->bitmasks + row, FREE_ENTITY, 1);
+			++destroyed;
+			break;
+		default:
+			assert(0 && "unknown command!");
+		}
+	}
+	if (destroyed > 0)
+	{
+		ecs_destroy_free_entities(ecs_table);
+	}
+}
+
+// spawns grouped by mask, every group is one ecs_spawn_batch
+static void play_spawn_commands(const ecs_commands_t* commands, ecs_table_t* ecs_table)
+{
+	sorted.size = 0;
+	for (int32_t t = 0; t < ECS_MAX_THREADS; ++t)
+	{
+		const ecs_command_buffer_t* buffer = commands->buffers + t;
+		for (int32_t i = 0; i < buffer->size; ++i)
+		{
+			if (buffer->commands[i].kind == COMMAND_SPAWN)
+			{
+				sorted.keys[sorted.size++] = make_key(signature_hash(buffer->commands[i].mask), t, i);
+			}
+		}
+	}
+	qsort(sorted.keys, sorted.size, sizeof *sorted.keys, compare_keys);
+	for (int32_t k = 0; k < sorted.size;)
+	{
+		// NOTE: masks whose hashes collide can interleave, that only splits the batch
+		const signature_t mask = key_command(commands, sorted.keys[k])->mask;
+		int32_t n = 1;
+		while (k + n < sorted.size && signature_eq(key_command(commands, sorted.keys[k + n])->mask, mask))
+		{
+			++n;
+		}
+		const int32_t first = ecs_spawn_batch(ecs_table, n, mask, NULL);
+		for (int32_t i = 0; i < n; ++i)
+		{
+			const uint8_t* data = key_data(commands, sorted.keys[k + i]);
+			void** components = ecs_table->components + (first + i) * NUM_COMPONENTS;
+			for (int32_t c = 0; c < NUM_COMPONENTS; ++c)
+			{
+				if (signature_test(mask, c))
+				{
+					memcpy(components[c], data, component_sizes[c]);
+					data += component_sizes[c];
+				}
+			}
+		}
+		k += n;
+	}
+}
+
+int32_t ecs_commands_playback(ecs_commands_t* commands, ecs_table_t* ecs_table)
+{
+	int32_t total = 0;
+	for (int32_t t = 0; t < ECS_MAX_THREADS; ++t)
+	{
+		total += commands->buffers[t].size;
+	}
+	if (total == 0)
+	{
+		return ecs_table->size;
+	}
+	reserve_keys(total);
+	play_entity_commands(commands, ecs_table);
+	play_spawn_commands(commands, ecs_table);
+	for (int32_t t = 0; t < ECS_MAX_THREADS; ++t)
+	{
+		commands->buffers[t].size = 0;
+		commands->buffers[t].data_size = 0;
+	}
+	return ecs_table->size;
+}
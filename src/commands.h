@@ -0,0 +1,70 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <stdint.h>
+#include "ecs.h"
+#include "entity.h"
+
+// structural changes recorded from inside a parallel phase and applied later at a sync
+// point.  Every thread records into its own buffer so recording never takes a lock,
+// thread is workers_index() on the worker pool or omp_get_thread_num() under OpenMP.
+
+typedef enum __attribute__((packed)) command_kind_t
+{
+	COMMAND_SET,
+	COMMAND_ADD,
+	COMMAND_REMOVE,
+	COMMAND_DESTROY,
+	COMMAND_SPAWN,
+} command_kind_t;
+
+typedef struct ecs_command_t
+{
+	command_kind_t kind;
+	component_t component;
+	entity_t entity;
+	signature_t mask; // spawn only
+	int32_t offset; // payload in the buffer's data, -1 if there is none
+} ecs_command_t;
+
+typedef struct ecs_command_buffer_t
+{
+	_Alignas(64) ecs_command_t* commands;
+	uint8_t* data; // component values, copied in when recording
+	int32_t size;
+	int32_t cap;
+	int32_t data_size;
+	int32_t data_cap;
+} ecs_command_buffer_t;
+
+typedef struct ecs_commands_t
+{
+	ecs_command_buffer_t buffers[ECS_MAX_THREADS];
+} ecs_commands_t;
+
+void ecs_commands_init(ecs_commands_t* commands);
+
+void ecs_commands_destroy(ecs_commands_t* commands);
+
+// entity with every component in mask.  initializers works like in ecs_spawn_batch,
+// the values are copied so they only have to live until the call returns.
+void ecs_commands_spawn(ecs_commands_t* commands, const int32_t thread, const signature_t mask, const void* const* initializers);
+
+void ecs_commands_destroy_entity(ecs_commands_t* commands, const int32_t thread, const entity_t entity);
+
+// no-op if the entity already has the component, value may be NULL for zeros
+void ecs_commands_add(ecs_commands_t* commands, const int32_t thread, const entity_t entity, const component_t component, const void* value);
+
+// no-op if the entity doesn't have the component
+void ecs_commands_remove(ecs_commands_t* commands, const int32_t thread, const entity_t entity, const component_t component);
+
+void ecs_commands_set(ecs_commands_t* commands, const int32_t thread, const entity_t entity, const component_t component, const void* value);
+
+// NOTE: not thread-safe, nothing may record or touch the table while this runs.
+// Commands on one entity are applied together, in recording order per thread and by
+// thread index across threads, commands on dead handles are dropped.  Destroys go
+// through ecs_destroy_free_entities, so if there are any, anything already flagged dies
+// here too.  Spawns come last and the ones with the same mask are batched.  Empties the buffers, returns the table size.
+int32_t ecs_commands_playback(ecs_commands_t* commands, ecs_table_t* ecs_table);
+
+#endif /* End COMMANDS_H */
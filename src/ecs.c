@@ -7,38 +7,68 @@
 #include <pthread.h>
 #include <sched.h>
 #include <errno.h>
-#include "allocators/arena.h"
-#include "allocators/pool.h"
+#include <omp.h>
+#include "allocators/cpool.h"
+#include "allocators/frame.h"
+#include "allocators/vmem.h"
+#include "workers.h"
+#include "numa.h"
+#include "scheduler.h"
+#include "fill.h"
+#include "simd.h"
+#include "profile.h"
+#include "trace.h"
 #include "components.h"
+#include "entity.h"
 
+// smallest number of entities a table commits at once
+#define TABLE_COMMIT_MIN 4096
+
+// sized for the biggest table by ecs_table_init
 static struct
 {
-	int32_t indices[ENTITY_CAP];
+	int32_t* indices;
 	int32_t size;
+	int32_t cap;
 } update_list = {0};
 
 
-static pool_t* component_pools = NULL;
-/* pool_t* entity_pool = NULL; */
+_Static_assert(NUM_COMPONENTS <= CPOOL_MAX_POOLS, "one pool per component, raise CPOOL_MAX_POOLS");
 
-static arena_t res_arena = {0};
-static arena_t arg_arena = {0};
+static cpool_t* component_pools = NULL;
 
-static arena_t* scratch_arenas = NULL;
-static int8_t scratch_index = 0;
 
 pthread_attr_t attr = {0};
 static float tick_delta;
 
-__attribute__((constructor))
-static void init_ecs(void)
+static pthread_once_t pools_once = PTHREAD_ONCE_INIT;
+
+// reserved with the first table instead of at load time, so whatever main sets up first
+// (vmem_set_huge_pages) applies to the pools too
+static void init_pools(void)
 {
 	component_pools = malloc(NUM_COMPONENTS * sizeof *component_pools);
+	// every table shares the pools, so they take the biggest one any table can be plus
+	// what the magazines hold.  Costs address space only until chunks get handed out.
 #define X(ENUM, TYPE) \
-	pool_init(component_pools + ENUM, sizeof(TYPE##_t), ENTITY_CAP);
+	if (cpool_init(component_pools + ENUM, sizeof(TYPE##_t), ECS_MAX_ENTITIES + ECS_MAX_THREADS * CPOOL_MAGAZINE_CAP) != 0) \
+	{ \
+		fprintf(stderr, "failed to reserve the " #TYPE " pool!\n"); \
+		abort(); \
+	}
 	COMPONENTS
 	#undef X
-	scratch_arenas = calloc(32, sizeof *scratch_arenas);
+	// chunks get handed to entities in whatever order they come back, so no thread owns
+	// any part of a pool.  Interleaving at least spreads the traffic over every socket.
+	for (int32_t i = 0; i < NUM_COMPONENTS; ++i)
+	{
+		numa_interleave(component_pools[i].allocation, component_pools[i].alloc_size);
+	}
+}
+
+__attribute__((constructor))
+static void init_ecs(void)
+{
 	// change thread attribute scheduling
 	assert(pthread_attr_init(&attr) == 0 && "failed to initialize POSIX thread attributes!");
 	struct sched_param param = {0};
@@ -58,37 +88,342 @@ static void init_ecs(void)
 	}
 }
 
-inline static void* scratch_checkout(const int32_t size)
+__attribute__((destructor))
+static void fini_ecs(void)
 {
-	return arena_scratch(scratch_arenas + scratch_index++, size);
+	workers_shutdown();
+	for (int32_t i = 0; i < NUM_COMPONENTS && component_pools; ++i)
+	{
+		cpool_destroy(component_pools + i);
+	}
+	frame_release();
+	free(update_list.indices);
 }
 
-inline static void* scratch_alloc(const int32_t index, int32_t size)
+inline static void mark_update(int32_t index) {
+	update_list.indices[update_list.size++] = index;
+}
+
+inline static int32_t query_matches(const ecs_query_t* query, const signature_t sig)
 {
-	return arena_scratch(scratch_arenas + index, size);
+	return signature_has(sig, query->all) && !signature_any(sig, query->none);
 }
 
-inline static void mark_update(int32_t index) {
-	update_list.indices[update_list.size++] = index;
+inline static void query_insert(ecs_query_t* query, const int32_t i)
+{
+	query->where[i] = query->size;
+	query->rows[query->size++] = i;
 }
 
-// NOTE: just set ecs_table size to zero. No need to do anything else.
+inline static void query_erase(ecs_query_t* query, const int32_t i)
+{
+	const int32_t k = query->where[i];
+	const int32_t last = query->rows[--query->size];
+	query->rows[k] = last;
+	query->where[last] = k;
+	query->where[i] = -1;
+}
+
+// spawning threads share the match lists, only one of them may touch them at a time
+static void queries_lock(ecs_table_t* ecs_table)
+{
+	while (__atomic_exchange_n(&ecs_table->query_lock, 1, __ATOMIC_ACQUIRE))
+	{
+		sched_yield();
+	}
+}
+
+static void queries_unlock(ecs_table_t* ecs_table)
+{
+	__atomic_store_n(&ecs_table->query_lock, 0, __ATOMIC_RELEASE);
+}
+
+// match entity i again after its bitmask changed
+static void queries_update(ecs_table_t* ecs_table, const int32_t i)
+{
+	queries_lock(ecs_table);
+	for (int32_t q = 0; q < ecs_table->num_queries; ++q)
+	{
+		ecs_query_t* query = ecs_table->queries[q];
+		const int32_t match = query_matches(query, ecs_table->bitmasks[i]);
+		if (match && query->where[i] < 0)
+		{
+			query_insert(query, i);
+		}
+		else if (!match && query->where[i] >= 0)
+		{
+			query_erase(query, i);
+		}
+	}
+	queries_unlock(ecs_table);
+}
+
+// entity m moved to id j, which is already out of every query
+static void queries_move(ecs_table_t* ecs_table, const int32_t j, const int32_t m)
+{
+	for (int32_t q = 0; q < ecs_table->num_queries; ++q)
+	{
+		ecs_query_t* query = ecs_table->queries[q];
+		const int32_t k = query->where[m];
+		query->where[j] = k;
+		query->where[m] = -1;
+		if (k >= 0)
+		{
+			query->rows[k] = j;
+		}
+	}
+}
+
+static void queries_erase(ecs_table_t* ecs_table, const int32_t j)
+{
+	for (int32_t q = 0; q < ecs_table->num_queries; ++q)
+	{
+		ecs_query_t* query = ecs_table->queries[q];
+		if (query->where[j] >= 0)
+		{
+			query_erase(query, j);
+		}
+	}
+}
+
+// move the last entity into the hole at j.  slots stays a permutation of the handle slots
+// with the free ones past size, so the dead slot just swaps places with the moved one.
+inline static void swap_remove(ecs_table_t* ecs_table, const int32_t j)
+{
+	int32_t* slots = ecs_table->slots;
+	const int32_t m = --ecs_table->size;
+	if (ecs_table->num_queries > 0)
+	{
+		queries_erase(ecs_table, j);
+		if (j < m)
+		{
+			queries_move(ecs_table, j, m);
+		}
+	}
+	const int32_t dead = slots[j];
+	++ecs_table->generations[dead];
+	if (j < m)
+	{
+		const int32_t moved = slots[m];
+		ecs_table->bitmasks[j] = ecs_table->bitmasks[m];
+		memcpy(ecs_table->components + j * NUM_COMPONENTS, ecs_table->components + m * NUM_COMPONENTS, NUM_COMPONENTS * sizeof(void*));
+		slots[j] = moved;
+		slots[m] = dead;
+		ecs_table->dense[moved] = j;
+		ecs_table->dense[dead] = m;
+	}
+}
+
+// NOTE: clear the tables with ecs_table_clear. No need to do anything else.
 void ecs_free_all(void)
 {
 	// free all the pools
-	for (int32_t i = 0; i < NUM_COMPONENTS; ++i)
+	for (int32_t i = 0; i < NUM_COMPONENTS && component_pools; ++i)
+	{
+		cpool_free_all(component_pools + i);
+	}
+}
+
+#define TABLE_ARRAYS \
+	X(components, NUM_COMPONENTS * sizeof(void*)) \
+	X(bitmasks, sizeof(signature_t)) \
+	X(slots, sizeof(int32_t)) \
+	X(dense, sizeof(int32_t)) \
+	X(generations, sizeof(uint32_t))
+
+// commit the match list for n entities, the new ones match nothing yet
+static void query_reserve(ecs_query_t* query, const int32_t n)
+{
+	const int32_t committed = query->committed;
+	if (n <= committed)
+	{
+		return;
+	}
+	vmem_commit(query->rows, committed * sizeof(int32_t), (n - committed) * sizeof(int32_t));
+	vmem_commit(query->where, committed * sizeof(int32_t), (n - committed) * sizeof(int32_t));
+	for (int32_t i = committed; i < n; ++i)
+	{
+		query->where[i] = -1;
+	}
+	query->committed = n;
+}
+
+// back the table for at least n entities.  Spawning threads all get here through the
+// atomic size bump, whoever takes the lock grows the table, the rest wait for it.
+static void table_reserve(ecs_table_t* ecs_table, const int32_t n)
+{
+	if (n <= __atomic_load_n(&ecs_table->committed, __ATOMIC_ACQUIRE))
+	{
+		return;
+	}
+	while (__atomic_exchange_n(&ecs_table->grow_lock, 1, __ATOMIC_ACQUIRE))
+	{
+		sched_yield();
+	}
+	const int32_t committed = ecs_table->committed;
+	if (n > committed)
+	{
+		int64_t want = (int64_t)committed * 2;
+		want = want > n ? want : n;
+		want = want > TABLE_COMMIT_MIN ? want : TABLE_COMMIT_MIN;
+		want = want < ecs_table->capacity ? want : ecs_table->capacity;
+#define X(NAME, SIZE) vmem_commit(ecs_table->NAME, committed * (SIZE), (want - committed) * (SIZE));
+		TABLE_ARRAYS
+#undef X
+		// fresh pages are zero so generations are good to go, the new handle slots
+		// just extend the permutation
+		for (int32_t i = committed; i < want; ++i)
+		{
+			ecs_table->slots[i] = i;
+			ecs_table->dense[i] = i;
+		}
+		for (int32_t q = 0; q < ecs_table->num_queries; ++q)
+		{
+			query_reserve(ecs_table->queries[q], want);
+		}
+		__atomic_store_n(&ecs_table->committed, (int32_t)want, __ATOMIC_RELEASE);
+	}
+	__atomic_store_n(&ecs_table->grow_lock, 0, __ATOMIC_RELEASE);
+}
+
+void ecs_table_init(ecs_table_t* ecs_table, const int32_t capacity)
+{
+	assert(capacity > 0 && capacity <= ECS_MAX_ENTITIES && "table capacity out of range!");
+	pthread_once(&pools_once, init_pools);
+	memset(ecs_table, 0x00, sizeof *ecs_table);
+	ecs_table->capacity = capacity;
+#define X(NAME, SIZE) ecs_table->NAME = vmem_reserve((size_t)capacity * (SIZE)); numa_spread(ecs_table->NAME, (size_t)capacity * (SIZE));
+	TABLE_ARRAYS
+#undef X
+	assert(ecs_table->components && ecs_table->bitmasks && ecs_table->slots && ecs_table->dense && ecs_table->generations && "failed to allocate ecs table!");
+	if (update_list.cap < capacity)
+	{
+		int32_t* indices = realloc(update_list.indices, capacity * sizeof *indices);
+		assert(indices && "failed to allocate update list!");
+		update_list.indices = indices;
+		update_list.cap = capacity;
+	}
+}
+
+void ecs_table_destroy(ecs_table_t* ecs_table)
+{
+	while (ecs_table->num_queries > 0)
+	{
+		ecs_query_destroy(ecs_table, ecs_table->queries[0]);
+	}
+#define X(NAME, SIZE) vmem_release(ecs_table->NAME, (size_t)ecs_table->capacity * (SIZE));
+	TABLE_ARRAYS
+#undef X
+	memset(ecs_table, 0x00, sizeof *ecs_table);
+}
+
+void ecs_table_clear(ecs_table_t* ecs_table)
+{
+	for (int32_t i = 0; i < ecs_table->size; ++i)
 	{
-		pool_free_all(component_pools + i);
+		++ecs_table->generations[ecs_table->slots[i]];
 	}
+	for (int32_t q = 0; q < ecs_table->num_queries; ++q)
+	{
+		ecs_query_t* query = ecs_table->queries[q];
+		for (int32_t k = 0; k < query->size; ++k)
+		{
+			query->where[query->rows[k]] = -1;
+		}
+		query->size = 0;
+	}
+	ecs_table->size = 0;
 }
 
+ecs_query_t* ecs_query_create(ecs_table_t* ecs_table, const signature_t all, const signature_t none)
+{
+	assert(!signature_test(signature_or(all, none), FREE_ENTITY) && "queries can't match FREE_ENTITY!");
+	if (ecs_table->num_queries == ECS_MAX_QUERIES)
+	{
+		fprintf(stderr, "TOO MANY QUERIES!\n");
+		assert(0);
+		return NULL;
+	}
+	ecs_query_t* query = calloc(1, sizeof *query);
+	assert(query && "failed to allocate query!");
+	query->all = all;
+	query->none = none;
+	query->rows = vmem_reserve((size_t)ecs_table->capacity * sizeof(int32_t));
+	query->where = vmem_reserve((size_t)ecs_table->capacity * sizeof(int32_t));
+	assert(query->rows && query->where && "failed to allocate query lists!");
+	query_reserve(query, ecs_table->committed);
+	for (int32_t i = 0; i < ecs_table->size; ++i)
+	{
+		if (query_matches(query, ecs_table->bitmasks[i]))
+		{
+			query_insert(query, i);
+		}
+	}
+	ecs_table->queries[ecs_table->num_queries++] = query;
+	return query;
+}
+
+void ecs_query_destroy(ecs_table_t* ecs_table, ecs_query_t* query)
+{
+	for (int32_t q = 0; q < ecs_table->num_queries; ++q)
+	{
+		if (ecs_table->queries[q] == query)
+		{
+			ecs_table->queries[q] = ecs_table->queries[--ecs_table->num_queries];
+			break;
+		}
+	}
+	vmem_release(query->rows, (size_t)ecs_table->capacity * sizeof(int32_t));
+	vmem_release(query->where, (size_t)ecs_table->capacity * sizeof(int32_t));
+	free(query);
+}
+
+entity_t ecs_entity_handle(const ecs_table_t* ecs_table, const int32_t id)
+{
+	const int32_t slot = ecs_table->slots[id];
+	return (entity_t){ .id = slot, .generation = ecs_table->generations[slot] };
+}
+
+int32_t ecs_entity_index(const ecs_table_t* ecs_table, const entity_t entity)
+{
+	// slots past committed were never handed out and aren't backed by memory
+	if (entity.id < 0 || entity.id >= __atomic_load_n(&ecs_table->committed, __ATOMIC_ACQUIRE))
+	{
+		return -1;
+	}
+	const int32_t i = ecs_table->dense[entity.id];
+	return ecs_table->generations[entity.id] == entity.generation && i < ecs_table->size ? i : -1;
+}
+
+// count rows off the end of the table, or -1 leaving size alone if they don't fit.  A plain
+// fetch_add would leave size past capacity on failure and the ticks walk uncommitted rows.
+static int32_t table_claim(ecs_table_t* ecs_table, const int32_t count)
+{
+	int32_t size = __atomic_load_n(&ecs_table->size, __ATOMIC_RELAXED);
+	do
+	{
+		if (count > ecs_table->capacity - size)
+		{
+			return -1;
+		}
+	}
+	while (!__atomic_compare_exchange_n(&ecs_table->size, &size, size + count, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	return size;
+}
+
+// NOTE: thread-safe together with ecs_add_component and ecs_set_*, slots are claimed atomically
 int32_t ecs_activate_entity(ecs_table_t* ecs_table)
 {
-	if (ecs_table->size < ENTITY_CAP)
+	const int32_t i = table_claim(ecs_table, 1);
+	if (i >= 0)
 	{
-		const int32_t i = ecs_table->size++;
+		table_reserve(ecs_table, i + 1);
 		// NOTE: don't bother setting all the components to zero.  Just set the bitmask to zero :)
-		ecs_table->bitmasks[i] = 0;
+		ecs_table->bitmasks[i] = SIGNATURE_EMPTY;
+		if (ecs_table->num_queries > 0)
+		{
+			queries_update(ecs_table, i);
+		}
 		return i;
 	}
 	else
@@ -101,10 +436,28 @@ int32_t ecs_activate_entity(ecs_table_t* ecs_table)
 
 void ecs_add_component(ecs_table_t* ecs_table, const int32_t id, const component_t component)
 {
-	ecs_table->components[NUM_COMPONENTS * id + component] = pool_calloc(component_pools + component);
-	ecs_table->bitmasks[id] |= 1 << component;
+	ecs_table->components[NUM_COMPONENTS * id + component] = cpool_calloc(component_pools + component);
+	signature_set(ecs_table->bitmasks + id, component);
+	if (ecs_table->num_queries > 0)
+	{
+		queries_update(ecs_table, id);
+	}
 }
 
+void ecs_remove_component(ecs_table_t* ecs_table, const int32_t id, const component_t component)
+{
+	// the destroy loops go by the signature too, the slot stays stale
+	if (!signature_test(ecs_table->bitmasks[id], component))
+	{
+		return;
+	}
+	cpool_free(component_pools + component, ecs_table->components[NUM_COMPONENTS * id + component]);
+	signature_clear(ecs_table->bitmasks + id, component);
+	if (ecs_table->num_queries > 0)
+	{
+		queries_update(ecs_table, id);
+	}
+}
 
 #define X(ENUM, NAME) void ecs_set_##NAME(ecs_table_t* ecs_table, const int32_t id, const NAME##_t* value) \
 { \
@@ -113,49 +466,222 @@ void ecs_add_component(ecs_table_t* ecs_table, const int32_t id, const component
 COMPONENTS
 #undef X
 
-#define FREE_ENTITY NUM_COMPONENTS
+static const int32_t component_sizes[NUM_COMPONENTS] = {
+#define X(_, NAME) sizeof(NAME##_t),
+	COMPONENTS
+#undef X
+};
+
+int32_t ecs_spawn_batch(ecs_table_t* ecs_table, const int32_t count, const signature_t mask, const void* const* initializers)
+{
+	const int32_t first = table_claim(ecs_table, count);
+	if (first < 0)
+	{
+		fprintf(stderr, "TOO MANY ENTITIES!\n");
+		assert(0);
+		return -1;
+	}
+	table_reserve(ecs_table, first + count);
+	stream_fill(ecs_table->bitmasks + first, count, &mask, sizeof mask);
+	void** components = ecs_table->components + first * NUM_COMPONENTS;
+	for (int32_t c = 0; c < NUM_COMPONENTS; ++c)
+	{
+		if (!signature_test(mask, c))
+		{
+			continue;
+		}
+		const int32_t size = component_sizes[c];
+		const void* value = initializers ? initializers[c] : NULL;
+		cpool_alloc_n(component_pools + c, count, components + c, NUM_COMPONENTS);
+		// fill every run of adjacent chunks in one go
+		for (int32_t i = 0; i < count;)
+		{
+			uint8_t* run = components[i * NUM_COMPONENTS + c];
+			int32_t n = 1;
+			while (i + n < count && (uint8_t*)components[(i + n) * NUM_COMPONENTS + c] == run + n * size)
+			{
+				++n;
+			}
+			if (value)
+			{
+				stream_fill(run, n, value, size);
+			}
+			else
+			{
+				memset(run, 0x00, n * size);
+			}
+			i += n;
+		}
+	}
+	if (ecs_table->num_queries > 0)
+	{
+		queries_lock(ecs_table);
+		for (int32_t q = 0; q < ecs_table->num_queries; ++q)
+		{
+			ecs_query_t* query = ecs_table->queries[q];
+			if (query_matches(query, mask))
+			{
+				for (int32_t i = first; i < first + count; ++i)
+				{
+					query_insert(query, i);
+				}
+			}
+		}
+		queries_unlock(ecs_table);
+	}
+	return first;
+}
+
+static void validate_fail(const char* what, const int32_t i)
+{
+	fprintf(stderr, "ecs_validate: %s (entity %d)\n", what, i);
+	assert(0);
+}
+
+void ecs_validate(const ecs_table_t* ecs_table)
+{
+	const int32_t n = ecs_table->size;
+	const int32_t committed = ecs_table->committed;
+	if (n < 0 || n > committed || committed > ecs_table->capacity)
+	{
+		validate_fail("size out of range", n);
+	}
+	for (int32_t i = 0; i < committed; ++i)
+	{
+		const int32_t slot = ecs_table->slots[i];
+		if (slot < 0 || slot >= committed || ecs_table->dense[slot] != i)
+		{
+			validate_fail("handle slots out of sync", i);
+		}
+	}
+	signature_t valid_bits = SIGNATURE_EMPTY;
+	for (int32_t bit = 0; bit <= FREE_ENTITY; ++bit)
+	{
+		signature_set(&valid_bits, bit);
+	}
+	for (int32_t c = 0; c < NUM_COMPONENTS; ++c)
+	{
+		const cpool_t* pool = component_pools + c;
+		int32_t live = 0;
+		// chunks past top were never handed out
+		const int32_t top = atomic_load(&pool->top);
+		uint8_t* owned = calloc(top + 1, 1);
+		assert(owned && "failed to allocate validation buffer!");
+		for (int32_t i = 0; i < n; ++i)
+		{
+			const signature_t bitmask = ecs_table->bitmasks[i];
+			if (!signature_has(valid_bits, bitmask))
+			{
+				validate_fail("unknown bits in bitmask", i);
+			}
+			if (!signature_test(bitmask, c))
+			{
+				continue;
+			}
+			const uint8_t* p = ecs_table->components[i * NUM_COMPONENTS + c];
+			const ptrdiff_t offset = p - pool->allocation;
+			if (offset < 0 || offset >= (ptrdiff_t)top * pool->chunk_size || offset % pool->chunk_size != 0)
+			{
+				validate_fail("component pointer outside of its pool", i);
+			}
+			const int32_t chunk = offset / pool->chunk_size;
+			if (owned[chunk])
+			{
+				validate_fail("component shared by two entities", i);
+			}
+			owned[chunk] = 1;
+			++live;
+		}
+		const int32_t free_count = cpool_free_count(pool);
+		if (free_count < 0)
+		{
+			validate_fail("corrupt pool free list", c);
+		}
+		// other tables share the pool, so only this one's chunks can be checked against it
+		if (live > pool->chunk_cap - free_count)
+		{
+			validate_fail("pool double freed a component", c);
+		}
+		free(owned);
+	}
+	for (int32_t q = 0; q < ecs_table->num_queries; ++q)
+	{
+		const ecs_query_t* query = ecs_table->queries[q];
+		int32_t matched = 0;
+		for (int32_t i = 0; i < committed; ++i)
+		{
+			const int32_t k = query->where[i];
+			if (i >= n ? k >= 0 : (k >= 0) != query_matches(query, ecs_table->bitmasks[i]))
+			{
+				validate_fail("query match list out of date", i);
+			}
+			if (k >= 0 && (k >= query->size || query->rows[k] != i))
+			{
+				validate_fail("query rows out of sync", i);
+			}
+			matched += k >= 0;
+		}
+		if (matched != query->size)
+		{
+			validate_fail("query size out of sync", q);
+		}
+	}
+}
+
+#ifdef ECS_VALIDATE
+#define VALIDATE_TICK(ecs_table) ecs_validate(ecs_table)
+#else
+#define VALIDATE_TICK(ecs_table)
+#endif
+
 int32_t single_thread_tick(ecs_table_t* ecs_table, const float delta)
 {
+	PROFILE_TICK_BEGIN(__func__);
+	frame_begin();
 	/* entity_t* entities = ecs_table->entities; */
-	uint8_t* bitmasks = ecs_table->bitmasks;
+	signature_t* bitmasks = ecs_table->bitmasks;
 	void** components = ecs_table->components;
-	uint8_t mask = 1 << FREE_ENTITY;
+	PROFILE_PHASE_BEGIN(PROFILE_DESTROY_SCAN);
+	signature_t mask = SIGNATURE(FREE_ENTITY);
 	update_list.size = 0;
 	for (int32_t i = 0; i < ecs_table->size; ++i)
 	{
-		if (bitmasks[i] & mask)
+		if (signature_has(bitmasks[i], mask))
 		{
 			mark_update(i);
 		}
 	}
+	PROFILE_PHASE_END(PROFILE_DESTROY_SCAN, ecs_table->size);
 	if (update_list.size > 0)
 	{
 		const int32_t n = update_list.size;
+		PROFILE_DESTROYED(n);
+		PROFILE_PHASE_BEGIN(PROFILE_POOL_FREE);
 		for (int32_t i = 0; i < NUM_COMPONENTS; ++i)
 		{
 			for (int32_t j = 0; j < n; ++j)
 			{
-				const int32_t k = update_list.indices[j] * NUM_COMPONENTS;
-				pool_free(component_pools + i, components[k + i]);
+				const int32_t row = update_list.indices[j];
+				if (signature_test(bitmasks[row], i))
+				{
+					cpool_free(component_pools + i, components[row * NUM_COMPONENTS + i]);
+				}
 			}
 		}
-		const size_t sizeof_components = NUM_COMPONENTS * sizeof(void*);
+		PROFILE_PHASE_END(PROFILE_POOL_FREE, n);
+		PROFILE_PHASE_BEGIN(PROFILE_COMPACT);
 		for (int32_t i = n - 1;  i >= 0; --i)
 		{
-			const int32_t j = update_list.indices[i];
-			const int32_t m = --ecs_table->size;
-			if (j < m)
-			{
-				bitmasks[j] = bitmasks[m];
-				memcpy(components + j * NUM_COMPONENTS, components + m * NUM_COMPONENTS, sizeof_components);
-			}
+			swap_remove(ecs_table, update_list.indices[i]);
 		}
+		PROFILE_PHASE_END(PROFILE_COMPACT, n);
 	}
-	mask = (1 << POSITION) | (1 << VELOCITY);
+	PROFILE_PHASE_BEGIN(PROFILE_MOVEMENT);
+	mask = SIGNATURE(POSITION, VELOCITY);
 	update_list.size = 0;
 	for (int32_t i = 0; i < ecs_table->size; ++i)
 	{
-		if ((bitmasks[i] & mask) == mask)
+		if (signature_has(bitmasks[i], mask))
 		{
 			mark_update(i);
 		}
@@ -163,8 +689,8 @@ int32_t single_thread_tick(ecs_table_t* ecs_table, const float delta)
 	if (update_list.size > 0)
 	{
 		const int32_t n = update_list.size;
-		position_t* positions = arena_scratch(&res_arena, n * sizeof *positions);
-		velocity_t* velocities = arena_scratch(&arg_arena, n * sizeof *velocities);
+		position_t* positions = frame_alloc(n * sizeof *positions);
+		velocity_t* velocities = frame_alloc(n * sizeof *velocities);
 		// populate
 		for (int32_t i = 0; i < n; ++i)
 		{
@@ -174,14 +700,7 @@ int32_t single_thread_tick(ecs_table_t* ecs_table, const float delta)
 			memcpy(velocities + i, components[k + VELOCITY], sizeof(velocity_t));
 		}
 		// update
-		for (int32_t i = 0; i < n; ++i)
-		{
-			const velocity_t v = velocities[i];
-			positions[i].x += delta * v.x;
-			positions[i].y += delta * v.y;
-			positions[i].z += delta * v.z;
-			/* printf("p%i: (%f,%f,%f)\n", i, positions[i].x, positions[i].y, positions[i].z); */
-		}
+		simd_move(positions, velocities, n, delta);
 		//copy to components
 		for (int32_t i = 0; i < n; ++i)
 		{
@@ -190,11 +709,13 @@ int32_t single_thread_tick(ecs_table_t* ecs_table, const float delta)
 			memcpy(components[k + POSITION], positions + i, sizeof(position_t));
 		}
 	}
-	mask = 1 << LIFETIME;
+	PROFILE_PHASE_END(PROFILE_MOVEMENT, update_list.size);
+	PROFILE_PHASE_BEGIN(PROFILE_LIFETIME);
+	mask = SIGNATURE(LIFETIME);
 	update_list.size = 0;
 	for (int32_t i = 0; i < ecs_table->size; ++i)
 	{
-		if (bitmasks[i] & mask)
+		if (signature_has(bitmasks[i], mask))
 		{
 			mark_update(i);
 		}
@@ -202,7 +723,7 @@ int32_t single_thread_tick(ecs_table_t* ecs_table, const float delta)
 	if (update_list.size > 0)
 	{
 		const int32_t n = update_list.size;
-		lifetime_t* lifetimes = arena_scratch(&arg_arena, n * sizeof *lifetimes);
+		lifetime_t* lifetimes = frame_alloc(n * sizeof *lifetimes);
 		// populate
 		for (int32_t i = 0; i < n; ++i)
 		{
@@ -211,10 +732,7 @@ int32_t single_thread_tick(ecs_table_t* ecs_table, const float delta)
 			memcpy(lifetimes + i, components[k + LIFETIME], sizeof(lifetime_t));
 		}
 		// update
-		for (int32_t i = 0; i < n; ++i)
-		{
-			lifetimes[i].value -= delta;
-		}
+		simd_decay(lifetimes, NULL, n, delta);
 		// copy to components & bitmask memels
 		for (int32_t i = 0; i < n; ++i)
 		{
@@ -224,26 +742,30 @@ int32_t single_thread_tick(ecs_table_t* ecs_table, const float delta)
 			/* printf("time: %f, bits: %x\n", lifetimes[i].value, lifetimes[i].bits); */
 			/* printf("bitshift0: %x\n", lifetimes[i].bits >> 31); */
 			/* printf("bitshift1: %x\n", (lifetimes[i].bits >> 31) << FREE_ENTITY); */
-			bitmasks[j] |= (lifetimes[i].bits >> 31) << FREE_ENTITY;
+			signature_flag(bitmasks + j, FREE_ENTITY, lifetimes[i].bits >> 31);
 			/* printf("res: %x\n", bitmasks[j] & (1 << FREE_ENTITY)); */
 		}
 	}
+	PROFILE_PHASE_END(PROFILE_LIFETIME, update_list.size);
+	VALIDATE_TICK(ecs_table);
+	PROFILE_TICK_END();
 	return ecs_table->size;
 }
 
 // WHY MEMCPY? WHY USE UPDATE_LIST???
 int32_t single_thread_tick_alt(ecs_table_t* ecs_table, const float delta)
 {
-	uint8_t* bitmasks = ecs_table->bitmasks;
+	PROFILE_TICK_BEGIN(__func__);
+	signature_t* bitmasks = ecs_table->bitmasks;
 	void** components = ecs_table->components;
 	if (ecs_table->size > 0)
 	{
+		PROFILE_PHASE_BEGIN(PROFILE_DESTROY);
 		const int32_t n = ecs_table->size;
-		const size_t sizeof_components = NUM_COMPONENTS * sizeof(void*);
-		const uint8_t mask = 1 << FREE_ENTITY;
+		const signature_t mask = SIGNATURE(FREE_ENTITY);
 		for (int32_t i = n - 1; i >= 0; --i)
 		{
-			if ((bitmasks[i] & mask) == 0x00)
+			if (!signature_has(bitmasks[i], mask))
 			{
 				// bp abuse lmao
 				continue;
@@ -251,27 +773,28 @@ int32_t single_thread_tick_alt(ecs_table_t* ecs_table, const float delta)
 			else
 			{
 				const int32_t k = i * NUM_COMPONENTS;
-				for (int8_t j = 0; j < NUM_COMPONENTS; ++j)
+				for (int32_t j = 0; j < NUM_COMPONENTS; ++j)
 				{
-					pool_free(component_pools + j, components[k + j]);
-				}
-				const int32_t m = --ecs_table->size;
-				if (i < m)
-				{
-					bitmasks[i] = bitmasks[m];
-					memcpy(components + k, components + m * NUM_COMPONENTS, sizeof_components);
+					if (signature_test(bitmasks[i], j))
+					{
+						cpool_free(component_pools + j, components[k + j]);
+					}
 				}
+				swap_remove(ecs_table, i);
 			}
 		}
+		PROFILE_DESTROYED(n - ecs_table->size);
+		PROFILE_PHASE_END(PROFILE_DESTROY, n);
 	}
 	if (ecs_table->size > 0)
 	{
+		PROFILE_PHASE_BEGIN(PROFILE_UPDATE);
 		const int32_t n = ecs_table->size;
-		const uint8_t pos_mask = (1 << POSITION) | (1 << VELOCITY);
-		const uint8_t l_mask = 1 << LIFETIME;
+		const signature_t pos_mask = SIGNATURE(POSITION, VELOCITY);
+		const signature_t l_mask = SIGNATURE(LIFETIME);
 		for (int32_t i = 0; i < n; ++i)
 		{
-			if ((bitmasks[i] & pos_mask) == pos_mask)
+			if (signature_has(bitmasks[i], pos_mask))
 			{
 				position_t* p = components[i * NUM_COMPONENTS + POSITION];
 				velocity_t v = *(velocity_t*)components[i * NUM_COMPONENTS + VELOCITY];
@@ -279,14 +802,122 @@ int32_t single_thread_tick_alt(ecs_table_t* ecs_table, const float delta)
 				p->y += delta * v.y;
 				p->z += delta * v.z;
 			}
-			if (bitmasks[i] & l_mask)
+			if (signature_has(bitmasks[i], l_mask))
 			{
 				lifetime_t* l = components[i * NUM_COMPONENTS + LIFETIME];
 				l->value -= delta;
-				bitmasks[i] |= (l->bits >> 31) << FREE_ENTITY;
+				signature_flag(bitmasks + i, FREE_ENTITY, l->bits >> 31);
+			}
+		}
+		PROFILE_PHASE_END(PROFILE_UPDATE, n);
+	}
+	VALIDATE_TICK(ecs_table);
+	PROFILE_TICK_END();
+	return ecs_table->size;
+}
+
+// the whole tick in one backwards sweep.  Entities flagged last tick get swap-removed as
+// they come up, whatever fills the hole comes from the end and has already been updated,
+// so every survivor is touched exactly once and nothing goes through a scratch buffer.
+int32_t single_thread_tick_fused(ecs_table_t* ecs_table, const float delta)
+{
+	PROFILE_TICK_BEGIN(__func__);
+	signature_t* bitmasks = ecs_table->bitmasks;
+	void** components = ecs_table->components;
+	const signature_t free_mask = SIGNATURE(FREE_ENTITY);
+	const signature_t pos_mask = SIGNATURE(POSITION, VELOCITY);
+	const signature_t l_mask = SIGNATURE(LIFETIME);
+	// the phases are interleaved per entity, the whole sweep counts as the update
+	PROFILE_PHASE_BEGIN(PROFILE_UPDATE);
+	const int32_t n = ecs_table->size;
+	for (int32_t i = n - 1; i >= 0; --i)
+	{
+		void** entity = components + i * NUM_COMPONENTS;
+		const signature_t bitmask = bitmasks[i];
+		if (signature_has(bitmask, free_mask))
+		{
+			for (int32_t c = 0; c < NUM_COMPONENTS; ++c)
+			{
+				if (signature_test(bitmask, c))
+				{
+					cpool_free(component_pools + c, entity[c]);
+				}
 			}
+			swap_remove(ecs_table, i);
+			continue;
+		}
+		if (signature_has(bitmask, pos_mask))
+		{
+			position_t* p = entity[POSITION];
+			const velocity_t* v = entity[VELOCITY];
+			p->x += delta * v->x;
+			p->y += delta * v->y;
+			p->z += delta * v->z;
+		}
+		if (signature_has(bitmask, l_mask))
+		{
+			lifetime_t* l = entity[LIFETIME];
+			l->value -= delta;
+			signature_flag(bitmasks + i, FREE_ENTITY, l->bits >> 31);
 		}
 	}
+	PROFILE_PHASE_END(PROFILE_UPDATE, n);
+	PROFILE_DESTROYED(n - ecs_table->size);
+	VALIDATE_TICK(ecs_table);
+	PROFILE_TICK_END();
+	return ecs_table->size;
+}
+
+// the destroy pass still scans since FREE_ENTITY gets flipped straight in the bitmasks,
+// the other two passes just walk the match lists
+int32_t single_thread_tick_query(ecs_table_t* ecs_table, const ecs_query_t* movers, const ecs_query_t* agers, const float delta)
+{
+	PROFILE_TICK_BEGIN(__func__);
+	frame_begin();
+	ecs_destroy_free_entities(ecs_table);
+	signature_t* bitmasks = ecs_table->bitmasks;
+	void** components = ecs_table->components;
+	PROFILE_PHASE_BEGIN(PROFILE_MOVEMENT);
+	if (movers->size > 0)
+	{
+		const int32_t n = movers->size;
+		const int32_t* rows = movers->rows;
+		position_t* positions = frame_alloc(n * sizeof *positions);
+		velocity_t* velocities = frame_alloc(n * sizeof *velocities);
+		for (int32_t i = 0; i < n; ++i)
+		{
+			const uint32_t k = rows[i] * NUM_COMPONENTS;
+			memcpy(positions + i, components[k + POSITION], sizeof(position_t));
+			memcpy(velocities + i, components[k + VELOCITY], sizeof(velocity_t));
+		}
+		simd_move(positions, velocities, n, delta);
+		for (int32_t i = 0; i < n; ++i)
+		{
+			memcpy(components[rows[i] * NUM_COMPONENTS + POSITION], positions + i, sizeof(position_t));
+		}
+	}
+	PROFILE_PHASE_END(PROFILE_MOVEMENT, movers->size);
+	PROFILE_PHASE_BEGIN(PROFILE_LIFETIME);
+	if (agers->size > 0)
+	{
+		const int32_t n = agers->size;
+		const int32_t* rows = agers->rows;
+		lifetime_t* lifetimes = frame_alloc(n * sizeof *lifetimes);
+		for (int32_t i = 0; i < n; ++i)
+		{
+			memcpy(lifetimes + i, components[rows[i] * NUM_COMPONENTS + LIFETIME], sizeof(lifetime_t));
+		}
+		simd_decay(lifetimes, NULL, n, delta);
+		for (int32_t i = 0; i < n; ++i)
+		{
+			const int32_t j = rows[i];
+			memcpy(components[j * NUM_COMPONENTS + LIFETIME], lifetimes + i, sizeof(lifetime_t));
+			signature_flag(bitmasks + j, FREE_ENTITY, lifetimes[i].bits >> 31);
+		}
+	}
+	PROFILE_PHASE_END(PROFILE_LIFETIME, agers->size);
+	VALIDATE_TICK(ecs_table);
+	PROFILE_TICK_END();
 	return ecs_table->size;
 }
 
@@ -300,16 +931,12 @@ typedef struct span_t
 	{
 		float delta;
 		void** components;
-		uint8_t* bitmasks;
+		signature_t* bitmasks;
 		ecs_table_t* ecs_table;
 	};
 	int32_t i;
 	int32_t n;
-	union
-	{
-		int32_t scratch;
-		component_t c;
-	};
+	void* scratch[2]; // frame buffers, filled by one phase and read by the next
 } span_t;
 
 void set_spans(span_t* spans, const int32_t num_threads, const int32_t n)
@@ -318,7 +945,7 @@ void set_spans(span_t* spans, const int32_t num_threads, const int32_t n)
 	const int32_t mod = n % num_threads;
 	spans->i = 0;
 	spans->n = div + (mod > 0);
-	for (uint8_t i = 1; i < num_threads - 1; ++i) {
+	for (int32_t i = 1; i < num_threads - 1; ++i) {
 		const int32_t k = spans[i - 1].n;
 		spans[i].i = k;
 		spans[i].n = k + div + (mod > i);
@@ -332,34 +959,38 @@ void set_spans(span_t* spans, const int32_t num_threads, const int32_t n)
 
 typedef struct free_args_t
 {
-	union
-	{
-		void** components;
-		ecs_table_t* ecs_table;
-	};
+	ecs_table_t* ecs_table;
 	component_t c;
 } free_args_t;
 
 static int free_components(void* args)
 {
+	TRACE_BEGIN();
 	const free_args_t* free_args = args;
-	void** components = free_args->components;
+	void** components = free_args->ecs_table->components;
+	const signature_t* bitmasks = free_args->ecs_table->bitmasks;
 	const component_t c = free_args->c;
 	for (int32_t i = 0; i < update_list.size; ++i)
 	{
 		const int32_t j = update_list.indices[i];
-		pool_free(component_pools + c, components[j * NUM_COMPONENTS + c]);
+		// removed components already went back to the pool
+		if (signature_test(bitmasks[j], c))
+		{
+			cpool_free(component_pools + c, components[j * NUM_COMPONENTS + c]);
+		}
 	}
+	TRACE_END(__func__, 0, update_list.size);
 	return 0;
 }
 
 static int populate_position_update_buffers(void* args)
 {
+	TRACE_BEGIN();
 	const span_t* span = args;
 	const void** components = span->components;
 	const int32_t n = span->n;
-	velocity_t* velocities = arg_arena.allocation;
-	position_t* positions = res_arena.allocation;
+	velocity_t* velocities = span->scratch[0];
+	position_t* positions = span->scratch[1];
 	for (int32_t i = span->i; i < n; ++i)
 	{
 		const int32_t j = update_list.indices[i];
@@ -367,555 +998,356 @@ static int populate_position_update_buffers(void* args)
 		memcpy(positions + i, components[k + POSITION], sizeof(position_t));
 		memcpy(velocities + i, components[k + VELOCITY], sizeof(velocity_t));
 	}
+	TRACE_END(__func__, span->i, span->n);
 	return 0;
 }
 
 static int update_positions(void* args)
 {
+	TRACE_BEGIN();
 	const span_t* span = args;
 	const float delta = span->delta;
 	const int32_t n = span->n;
-	velocity_t* velocities = arg_arena.allocation;
-	position_t* positions = res_arena.allocation;
-	for (int32_t i = span->i; i < n; ++i)
-	{
-		const velocity_t v = velocities[i];
-		positions[i].x += delta * v.x;
-		positions[i].y += delta * v.y;
-		positions[i].z += delta * v.z;
-	}
+	velocity_t* velocities = span->scratch[0];
+	position_t* positions = span->scratch[1];
+	simd_move(positions + span->i, velocities + span->i, n - span->i, delta);
+	TRACE_END(__func__, span->i, span->n);
 	return 0;
 }
 
 static int sync_positions(void* args)
 {
+	TRACE_BEGIN();
 	const span_t* span = args;
 	const int32_t n = span->n;
-	const position_t* positions = res_arena.allocation;
+	const position_t* positions = span->scratch[1];
 	void** components = span->components;
 	for (int32_t i = span->i; i < n; ++i)
 	{
 		const int32_t j = update_list.indices[i];
 		memcpy(components[j * NUM_COMPONENTS + POSITION], positions + i, sizeof(position_t));
 	}
+	TRACE_END(__func__, span->i, span->n);
 	return 0;
 }
 
 static int populate_lifetime_update_buffer(void* args)
 {
+	TRACE_BEGIN();
 	const span_t* span = args;
 	const int32_t n = span->n;
 	const void** components = span->components;
-	lifetime_t* lifetimes = res_arena.allocation;
+	lifetime_t* lifetimes = span->scratch[0];
 	for (int32_t i = span->i; i < n; ++i) {
 		const int32_t j = update_list.indices[i];
 		memcpy(lifetimes + i, components[j * NUM_COMPONENTS + LIFETIME], sizeof(lifetime_t));
 	}
+	TRACE_END(__func__, span->i, span->n);
 	return 0;
 }
 
 
 static int update_lifetimes(void* args)
 {
+	TRACE_BEGIN();
 	const span_t* span = args;
 	const int32_t n = span->n;
 	const float delta = span->delta;
-	lifetime_t* lifetimes = res_arena.allocation;
-	uint8_t* free_masks = arg_arena.allocation;
-	for (int32_t i = span->i; i < n; ++i)
-	{
-		lifetimes[i].value -= delta;
-		free_masks[i] = (lifetimes[i].bits >> 31) << FREE_ENTITY;
-	}
+	lifetime_t* lifetimes = span->scratch[0];
+	uint8_t* free_masks = span->scratch[1];
+	simd_decay(lifetimes + span->i, free_masks + span->i, n - span->i, delta);
+	TRACE_END(__func__, span->i, span->n);
 	return 0;
 }
 
 static int sync_lifetimes(void* args)
 {
+	TRACE_BEGIN();
 	const span_t* span = args;
 	const int32_t n = span->n;
-	const lifetime_t* lifetimes = res_arena.allocation;
+	const lifetime_t* lifetimes = span->scratch[0];
 	void** components = span->components;
 	for (int32_t i = span->i; i < n; ++i)
 	{
 		const int32_t j = update_list.indices[i];
 		memcpy(components[j * NUM_COMPONENTS + LIFETIME], lifetimes + i, sizeof(lifetime_t));
 	}
+	TRACE_END(__func__, span->i, span->n);
 	return 0;
 }
 
 static int sync_free_entity_flags(void* args)
 {
+	TRACE_BEGIN();
 	const span_t* span = args;
 	const int32_t n = span->n;
-	const uint8_t* flags = arg_arena.allocation;
-	uint8_t* bitmasks = span->bitmasks;
+	const uint8_t* flags = span->scratch[1];
+	signature_t* bitmasks = span->bitmasks;
 	for (int32_t i = span->i; i < n; ++i)
 	{
 		const int32_t j = update_list.indices[i];
-		bitmasks[j] |= flags[i];
+		signature_flag(bitmasks + j, FREE_ENTITY, flags[i]);
 	}
+	TRACE_END(__func__, span->i, span->n);
 	return 0;
 }
 
-int32_t multi_thread_tick(ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
+// runs func(args + i * stride) for every i and waits for all of them
+typedef void (*launch_t)(thrd_start_t func, void* args, const size_t stride, const int32_t count);
+
+typedef struct launch_item_t
+{
+	thrd_start_t func;
+	void* args;
+	int32_t slot;
+} launch_item_t;
+
+// fresh threads allocate from the frame slot of their index in the launch
+static int run_item(void* args)
 {
-	thrd_t* threads = alloca(num_threads * sizeof *threads);
+	const launch_item_t* item = args;
+	frame_set_slot(item->slot);
+	return item->func(item->args);
+}
+
+static void* run_pthread_item(void* args)
+{
+	run_item(args);
+	return NULL;
+}
+
+// one fresh thread per item, joined right away
+static void launch_threads(thrd_start_t func, void* args, const size_t stride, const int32_t count)
+{
+	thrd_t* threads = alloca(count * sizeof *threads);
+	launch_item_t* items = alloca(count * sizeof *items);
 	int t_res;
-	uint8_t* bitmasks = ecs_table->bitmasks;
-	void** components = ecs_table->components;
-	uint8_t mask = 1 << FREE_ENTITY;
-	update_list.size = 0;
-	for (int32_t i = 0; i < ecs_table->size; ++i)
-	{
-		if (bitmasks[i] & mask)
-		{
-			mark_update(i);
-		}
-	}
-	if (update_list.size > 0)
-	{
-		const int32_t n = update_list.size;
-		if (num_threads >= NUM_COMPONENTS)
-		{
-			free_args_t* args = alloca(NUM_COMPONENTS * sizeof *args);
-			for (int8_t i = 0; i < NUM_COMPONENTS; ++i)
-			{
-				args[i].components = components;
-				args[i].c = i;
-				thrd_create(threads + i, free_components, args + i);
-			}
-			for (int8_t i = 0; i < NUM_COMPONENTS; ++i)
-			{
-				thrd_join(threads[i], &t_res);
-			}
-		}
-		else
-		{
-			// lol. lmao even.
-		}
-		const size_t sizeof_components = NUM_COMPONENTS * sizeof(void*);
-		for (int32_t i = n - 1;  i >= 0; --i)
-		{
-			const int32_t j = update_list.indices[i];
-			const int32_t m = --ecs_table->size;
-			if (j < m)
-			{
-				bitmasks[j] = bitmasks[m];
-				/* for (int32_t k = 0; k < NUM_COMPONENTS; ++k) */
-				/* { */
-				/* 	components[j * NUM_COMPONENTS + k] = components[m * NUM_COMPONENTS + k]; */
-				/* } */
-				memcpy(components + j * NUM_COMPONENTS, components + m * NUM_COMPONENTS, sizeof_components);
-			}
-		}
-	}
-	mask = (1 << POSITION) | (1 << VELOCITY);
-	update_list.size = 0;
-	for (int32_t i = 0; i < ecs_table->size; ++i)
+	for (int32_t i = 0; i < count; ++i)
 	{
-		if ((bitmasks[i] & mask) == mask)
-		{
-			mark_update(i);
-		}
+		items[i] = (launch_item_t){ func, (uint8_t*)args + i * stride, i };
+		thrd_create(threads + i, run_item, items + i);
+		numa_pin(threads[i], i, count);
 	}
-	if (update_list.size > 0)
+	for (int32_t i = 0; i < count; ++i)
 	{
-		const int32_t n = update_list.size;
-		span_t* spans = alloca(num_threads * sizeof *spans);
-		arena_scratch(&arg_arena, n * sizeof(velocity_t));
-		arena_scratch(&res_arena, n * sizeof(position_t));
-		set_spans(spans, num_threads, n);
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			spans[i].components = components;
-			thrd_create(threads + i, populate_position_update_buffers, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			spans[i].delta = delta;
-			thrd_create(threads + i, update_positions, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			spans[i].components = components;
-			thrd_create(threads + i, sync_positions, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
-		}
+		thrd_join(threads[i], &t_res);
 	}
-	mask = 1 << LIFETIME;
-	update_list.size = 0;
-	for (int32_t i = 0; i < ecs_table->size; ++i)
-	{
-		if (bitmasks[i] & mask)
-		{
-			mark_update(i);
-		}
-	}
-	if (update_list.size > 0)
-	{
-		const int32_t n = update_list.size;
-		arena_scratch(&res_arena, n * sizeof(lifetime_t));
-		arena_scratch(&arg_arena, n * sizeof(uint8_t));
-		span_t* spans = alloca(num_threads * sizeof *spans);
-		set_spans(spans, num_threads, n);
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			spans[i].components = components;
-			thrd_create(threads + i, populate_lifetime_update_buffer, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			spans[i].delta = delta;
-			thrd_create(threads + i, update_lifetimes, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			spans[i].components = components;
-			thrd_create(threads + i, sync_lifetimes, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			spans[i].bitmasks = bitmasks;
-			thrd_create(threads + i, sync_free_entity_flags, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
-		}
-	}
-	return ecs_table->size;
 }
 
-/********************/
-/* multi-arena hell */
-/********************/
+// slices smaller than this aren't worth the launches
+#define FILTER_MIN_ROWS (1 << 14)
 
-static int populate_position_update_buffers2(void* args)
+typedef struct filter_span_t
 {
-	const span_t* span = args;
-	const void** components = span->components;
-	const int32_t scratch = span->scratch;
-	const int32_t i0 = span->i;
-	const int32_t n = span->n;
-	velocity_t* restrict velocities = scratch_arenas[scratch].allocation;
-	position_t* restrict positions = scratch_arenas[scratch + 1].allocation;
-	for (int32_t i = 0; i < n - i0; ++i)
-	{
-		const int32_t j = update_list.indices[i + i0];
-		const int32_t k = NUM_COMPONENTS * j;
-		memcpy(positions + i, components[k + POSITION], sizeof(position_t));
-		memcpy(velocities + i, components[k + VELOCITY], sizeof(velocity_t));
-	}
-	return 0;
-}
-static int update_positions2(void* args)
+	const signature_t* bitmasks;
+	signature_t mask;
+	int32_t i;
+	int32_t n;
+	int32_t offset; // match count after counting, first slot in update_list after the scan
+} filter_span_t;
+
+// rows [i0, n) that have every bit of mask, ascending into out.  Only counts if out is NULL.
+inline static int32_t filter_rows(const signature_t* bitmasks, const signature_t mask, const int32_t i0, const int32_t n, int32_t* out)
 {
-	const span_t* span = args;
-	const float delta = span->delta;
-	const int32_t i0 = span->i;
-	const int32_t n = span->n;
-	const int32_t scratch = span->scratch;
-	const velocity_t* restrict velocities = scratch_arenas[scratch].allocation;
-	position_t* restrict positions = scratch_arenas[scratch + 1].allocation;
-	for (int32_t i = 0; i < n - i0; ++i)
+#ifndef SIGNATURE_WORDS
+	if (sizeof(signature_t) == 1)
 	{
-		const velocity_t v = velocities[i];
-		positions[i].x += delta * v.x;
-		positions[i].y += delta * v.y;
-		positions[i].z += delta * v.z;
+		return simd_select((const uint8_t*)(bitmasks + i0), n - i0, mask, i0, out);
 	}
-	return 0;
-}
-
-static int sync_positions2(void* args)
-{
-	const span_t* span = args;
-	const int32_t i0 = span->i;
-	const int32_t n = span->n;
-	const int32_t scratch = span->scratch;
-	const position_t* restrict positions = scratch_arenas[scratch + 1].allocation;
-	void** components = span->components;
-	for (int32_t i = 0; i < n - i0; ++i)
+#endif
+	int32_t k = 0;
+	for (int32_t i = i0; i < n; ++i)
 	{
-		const int32_t j = update_list.indices[i + i0];
-		memcpy(components[j * NUM_COMPONENTS + POSITION], positions + i, sizeof(position_t));
+		if (signature_has(bitmasks[i], mask))
+		{
+			if (out)
+			{
+				out[k] = i;
+			}
+			++k;
+		}
 	}
-	return 0;
+	return k;
 }
 
-static int populate_lifetime_update_buffer2(void* args)
+static int count_matches(void* args)
 {
-	const span_t* span = args;
-	const int32_t i0 = span->i;
-	const int32_t n = span->n;
-	const int32_t scratch = span->scratch;
-	const void** components = span->components;
-	lifetime_t* restrict lifetimes = scratch_arenas[scratch].allocation;
-	for (int32_t i = 0; i < n - i0; ++i) {
-		const int32_t j = update_list.indices[i + i0];
-		memcpy(lifetimes + i, components[j * NUM_COMPONENTS + LIFETIME], sizeof(lifetime_t));
-	}
+	TRACE_BEGIN();
+	filter_span_t* span = args;
+	span->offset = filter_rows(span->bitmasks, span->mask, span->i, span->n, NULL);
+	TRACE_END(__func__, span->i, span->n);
 	return 0;
 }
 
-static int update_lifetimes2(void* args)
+static int scatter_matches(void* args)
 {
-	const span_t* span = args;
-	const int32_t i0 = span->i;
-	const int32_t n = span->n;
-	const float delta = span->delta;
-	const int32_t scratch = span->scratch;
-	lifetime_t* restrict lifetimes = scratch_arenas[scratch].allocation;
-	uint8_t* restrict free_masks = scratch_arenas[scratch + 1].allocation;
-	for (int32_t i = 0; i < n - i0; ++i)
-	{
-		lifetimes[i].value -= delta;
-		free_masks[i] = (lifetimes[i].bits >> 31) << FREE_ENTITY;
-	}
+	TRACE_BEGIN();
+	const filter_span_t* span = args;
+	filter_rows(span->bitmasks, span->mask, span->i, span->n, update_list.indices + span->offset);
+	TRACE_END(__func__, span->i, span->n);
 	return 0;
 }
 
-static int sync_lifetimes2(void* args)
+// update_list = every row that has mask, in order.  Threads count the matches in their
+// slice, an exclusive scan of the counts gives each slice its offset and the threads
+// write their matches there, so the list comes out dense without any atomics.
+static void filter_update_list(const ecs_table_t* ecs_table, const signature_t mask, const int32_t num_threads, launch_t launch)
 {
-	const span_t* span = args;
-	const int32_t i0 = span->i;
-	const int32_t n = span->n;
-	const lifetime_t* restrict lifetimes = scratch_arenas[span->scratch].allocation;
-	void** components = span->components;
-	for (int32_t i = 0; i < n - i0; ++i)
+	const int32_t size = ecs_table->size;
+	const int32_t m = size / FILTER_MIN_ROWS < num_threads ? size / FILTER_MIN_ROWS : num_threads;
+	if (m <= 1)
 	{
-		const int32_t j = update_list.indices[i + i0];
-		memcpy(components[j * NUM_COMPONENTS + LIFETIME], lifetimes + i, sizeof(lifetime_t));
+		update_list.size = filter_rows(ecs_table->bitmasks, mask, 0, size, update_list.indices);
+		return;
 	}
-	return 0;
-}
-
-static int sync_free_entity_flags2(void* args)
-{
-	const span_t* span = args;
-	const int32_t i0 = span->i;
-	const int32_t n = span->n;
-	const uint8_t* restrict flags = scratch_arenas[span->scratch + 1].allocation;
-	uint8_t* bitmasks = span->bitmasks;
-	for (int32_t i = 0; i < n - i0; ++i)
+	filter_span_t* spans = alloca(m * sizeof *spans);
+	for (int32_t i = 0; i < m; ++i)
 	{
-		const int32_t j = update_list.indices[i + i0];
-		bitmasks[j] |= flags[i];
+		spans[i].bitmasks = ecs_table->bitmasks;
+		spans[i].mask = mask;
+		spans[i].i = (int64_t)size * i / m;
+		spans[i].n = (int64_t)size * (i + 1) / m;
 	}
-	return 0;
-}
-
-int32_t multi_thread_tick2(ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
-{
-	thrd_t* threads = alloca(num_threads * sizeof *threads);
-	int t_res;
-	uint8_t* bitmasks = ecs_table->bitmasks;
-	void** components = ecs_table->components;
-	uint8_t mask = 1 << FREE_ENTITY;
-	update_list.size = 0;
-	for (int32_t i = 0; i < ecs_table->size; ++i)
-	{
-		if (bitmasks[i] & mask)
-		{
-			mark_update(i);
-		}
+	launch(count_matches, spans, sizeof *spans, m);
+	int32_t total = 0;
+	for (int32_t i = 0; i < m; ++i)
+	{
+		const int32_t count = spans[i].offset;
+		spans[i].offset = total;
+		total += count;
 	}
+	launch(scatter_matches, spans, sizeof *spans, m);
+	update_list.size = total;
+}
+
+static int32_t buffered_tick(ecs_table_t* ecs_table, const float delta, const int32_t num_threads, launch_t launch)
+{
+	frame_begin();
+	signature_t* bitmasks = ecs_table->bitmasks;
+	void** components = ecs_table->components;
+	PROFILE_PHASE_BEGIN(PROFILE_DESTROY_SCAN);
+	signature_t mask = SIGNATURE(FREE_ENTITY);
+	filter_update_list(ecs_table, mask, num_threads, launch);
+	PROFILE_PHASE_END(PROFILE_DESTROY_SCAN, ecs_table->size);
 	if (update_list.size > 0)
 	{
 		const int32_t n = update_list.size;
-		scratch_index = 0;
-		if (num_threads >= NUM_COMPONENTS)
-		{
-			/* free_args_t* args = alloca(NUM_COMPONENTS * sizeof *args); */
-			for (int8_t i = 0; i < NUM_COMPONENTS; ++i)
-			{
-				free_args_t* args = scratch_checkout(sizeof(free_args_t));
-				args->components = components;
-				args->c = i;
-				thrd_create(threads + i, free_components, args);
-			}
-			for (int8_t i = 0; i < NUM_COMPONENTS; ++i)
-			{
-				thrd_join(threads[i], &t_res);
-			}
-		}
-		else
+		PROFILE_DESTROYED(n);
+		PROFILE_PHASE_BEGIN(PROFILE_POOL_FREE);
+		free_args_t* args = alloca(NUM_COMPONENTS * sizeof *args);
+		for (int32_t i = 0; i < NUM_COMPONENTS; ++i)
 		{
-			// lol. lmao even.
+			args[i].ecs_table = ecs_table;
+			args[i].c = i;
 		}
-		const size_t sizeof_components = NUM_COMPONENTS * sizeof(void*);
+		launch(free_components, args, sizeof *args, NUM_COMPONENTS);
+		PROFILE_PHASE_END(PROFILE_POOL_FREE, n);
+		PROFILE_PHASE_BEGIN(PROFILE_COMPACT);
 		for (int32_t i = n - 1;  i >= 0; --i)
 		{
-			const int32_t j = update_list.indices[i];
-			const int32_t m = --ecs_table->size;
-			if (j < m)
-			{
-				bitmasks[j] = bitmasks[m];
-				/* for (int32_t k = 0; k < NUM_COMPONENTS; ++k) */
-				/* { */
-				/* 	components[j * NUM_COMPONENTS + k] = components[m * NUM_COMPONENTS + k]; */
-				/* } */
-				memcpy(components + j * NUM_COMPONENTS, components + m * NUM_COMPONENTS, sizeof_components);
-			}
-		}
-	}
-	mask = (1 << POSITION) | (1 << VELOCITY);
-	update_list.size = 0;
-	for (int32_t i = 0; i < ecs_table->size; ++i)
-	{
-		if ((bitmasks[i] & mask) == mask)
-		{
-			mark_update(i);
+			swap_remove(ecs_table, update_list.indices[i]);
 		}
+		PROFILE_PHASE_END(PROFILE_COMPACT, n);
 	}
+	PROFILE_PHASE_BEGIN(PROFILE_MOVEMENT);
+	mask = SIGNATURE(POSITION, VELOCITY);
+	filter_update_list(ecs_table, mask, num_threads, launch);
 	if (update_list.size > 0)
 	{
 		const int32_t n = update_list.size;
-		scratch_index = 0;
 		span_t* spans = alloca(num_threads * sizeof *spans);
+		// one buffer shared by all spans, the kernels index it by update list row
+		velocity_t* velocities = frame_alloc(n * sizeof *velocities);
+		position_t* positions = frame_alloc(n * sizeof *positions);
 		set_spans(spans, num_threads, n);
-		for (int8_t i = 0; i < num_threads; ++i)
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].components = components;
-			spans[i].scratch = 2 * i;
-			const int32_t m = spans[i].n - spans[i].i;
-			scratch_checkout(m  * sizeof(velocity_t));
-			scratch_checkout(m  * sizeof(position_t));
-			thrd_create(threads + i, populate_position_update_buffers2, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
+			spans[i].scratch[0] = velocities;
+			spans[i].scratch[1] = positions;
 		}
-		for (int8_t i = 0; i < num_threads; ++i)
+		launch(populate_position_update_buffers, spans, sizeof *spans, num_threads);
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].delta = delta;
-			thrd_create(threads + i, update_positions2, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
 		}
-		for (int8_t i = 0; i < num_threads; ++i)
+		launch(update_positions, spans, sizeof *spans, num_threads);
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].components = components;
-			thrd_create(threads + i, sync_positions2, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
-		}
-	}
-	mask = 1 << LIFETIME;
-	update_list.size = 0;
-	for (int32_t i = 0; i < ecs_table->size; ++i)
-	{
-		if (bitmasks[i] & mask)
-		{
-			mark_update(i);
 		}
+		launch(sync_positions, spans, sizeof *spans, num_threads);
 	}
+	PROFILE_PHASE_END(PROFILE_MOVEMENT, update_list.size);
+	PROFILE_PHASE_BEGIN(PROFILE_LIFETIME);
+	mask = SIGNATURE(LIFETIME);
+	filter_update_list(ecs_table, mask, num_threads, launch);
 	if (update_list.size > 0)
 	{
 		const int32_t n = update_list.size;
-		scratch_index = 0;
+		lifetime_t* lifetimes = frame_alloc(n * sizeof *lifetimes);
+		uint8_t* free_masks = frame_alloc(n * sizeof *free_masks);
 		span_t* spans = alloca(num_threads * sizeof *spans);
 		set_spans(spans, num_threads, n);
-		for (int8_t i = 0; i < num_threads; ++i)
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].components = components;
-			spans[i].scratch = 2 * i;
-			const int32_t m = spans[i].n - spans[i].i;
-			scratch_checkout(m * sizeof(lifetime_t));
-			scratch_checkout(m * sizeof(uint8_t));
-			thrd_create(threads + i, populate_lifetime_update_buffer2, spans + i);
+			spans[i].scratch[0] = lifetimes;
+			spans[i].scratch[1] = free_masks;
 		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
+		launch(populate_lifetime_update_buffer, spans, sizeof *spans, num_threads);
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].delta = delta;
-			thrd_create(threads + i, update_lifetimes2, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
 		}
-		for (int8_t i = 0; i < num_threads; ++i)
+		launch(update_lifetimes, spans, sizeof *spans, num_threads);
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].components = components;
-			thrd_create(threads + i, sync_lifetimes2, spans + i);
 		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
+		launch(sync_lifetimes, spans, sizeof *spans, num_threads);
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].bitmasks = bitmasks;
-			thrd_create(threads + i, sync_free_entity_flags2, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
 		}
+		launch(sync_free_entity_flags, spans, sizeof *spans, num_threads);
 	}
+	PROFILE_PHASE_END(PROFILE_LIFETIME, update_list.size);
+	VALIDATE_TICK(ecs_table);
 	return ecs_table->size;
 }
 
+int32_t multi_thread_tick(ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
+{
+	PROFILE_TICK_BEGIN(__func__);
+	const int32_t size = buffered_tick(ecs_table, delta, num_threads, launch_threads);
+	PROFILE_TICK_END();
+	return size;
+}
 
-/*****************/
-/* POSIX THREADS */
-/*****************/
-
-static void* free_componentsp(void* args)
+int32_t multi_thread_tick_workers(ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
 {
-	const free_args_t* free_args = args;
-	void** components = free_args->components;
-	const component_t c = free_args->c;
-	for (int32_t i = 0; i < update_list.size; ++i)
-	{
-		const int32_t j = update_list.indices[i];
-		pool_free(component_pools + c, components[j * NUM_COMPONENTS + c]);
-	}
-	return NULL;
+	workers_init(num_threads);
+	PROFILE_TICK_BEGIN(__func__);
+	const int32_t size = buffered_tick(ecs_table, delta, num_threads, workers_run);
+	PROFILE_TICK_END();
+	return size;
 }
 
-static void* populate_position_update_buffersp(void* args)
+/********************/
+/* multi-arena hell */
+/********************/
+
+static int populate_position_update_buffers2(void* args)
 {
-	const span_t* span = args;
+	TRACE_BEGIN();
+	span_t* span = args;
 	const void** components = span->components;
-	const int32_t scratch = span->scratch;
 	const int32_t i0 = span->i;
 	const int32_t n = span->n;
-	velocity_t* restrict velocities = scratch_arenas[scratch].allocation;
-	position_t* restrict positions = scratch_arenas[scratch + 1].allocation;
+	// from this thread's frame slot, the later phases find them in the span
+	velocity_t* restrict velocities = span->scratch[0] = frame_alloc((n - i0) * sizeof *velocities);
+	position_t* restrict positions = span->scratch[1] = frame_alloc((n - i0) * sizeof *positions);
 	for (int32_t i = 0; i < n - i0; ++i)
 	{
 		const int32_t j = update_list.indices[i + i0];
@@ -923,262 +1355,252 @@ static void* populate_position_update_buffersp(void* args)
 		memcpy(positions + i, components[k + POSITION], sizeof(position_t));
 		memcpy(velocities + i, components[k + VELOCITY], sizeof(velocity_t));
 	}
-	return NULL;
+	TRACE_END(__func__, span->i, span->n);
+	return 0;
 }
-static void* update_positionsp(void* args)
+static int update_positions2(void* args)
 {
+	TRACE_BEGIN();
 	const span_t* span = args;
 	const float delta = span->delta;
 	const int32_t i0 = span->i;
 	const int32_t n = span->n;
-	const int32_t scratch = span->scratch;
-	const velocity_t* restrict velocities = scratch_arenas[scratch].allocation;
-	position_t* restrict positions = scratch_arenas[scratch + 1].allocation;
-	for (int32_t i = 0; i < n - i0; ++i)
-	{
-		const velocity_t v = velocities[i];
-		positions[i].x += delta * v.x;
-		positions[i].y += delta * v.y;
-		positions[i].z += delta * v.z;
-	}
-	return NULL;
+	const velocity_t* restrict velocities = span->scratch[0];
+	position_t* restrict positions = span->scratch[1];
+	simd_move(positions, velocities, n - i0, delta);
+	TRACE_END(__func__, span->i, span->n);
+	return 0;
 }
 
-static void* sync_positionsp(void* args)
+static int sync_positions2(void* args)
 {
+	TRACE_BEGIN();
 	const span_t* span = args;
 	const int32_t i0 = span->i;
 	const int32_t n = span->n;
-	const int32_t scratch = span->scratch;
-	const position_t* restrict positions = scratch_arenas[scratch + 1].allocation;
+	const position_t* restrict positions = span->scratch[1];
 	void** components = span->components;
 	for (int32_t i = 0; i < n - i0; ++i)
 	{
 		const int32_t j = update_list.indices[i + i0];
 		memcpy(components[j * NUM_COMPONENTS + POSITION], positions + i, sizeof(position_t));
 	}
-	return NULL;
+	TRACE_END(__func__, span->i, span->n);
+	return 0;
 }
 
-static void* populate_lifetime_update_bufferp(void* args)
+static int populate_lifetime_update_buffer2(void* args)
 {
-	const span_t* span = args;
+	TRACE_BEGIN();
+	span_t* span = args;
 	const int32_t i0 = span->i;
 	const int32_t n = span->n;
-	const int32_t scratch = span->scratch;
 	const void** components = span->components;
-	lifetime_t* restrict lifetimes = scratch_arenas[scratch].allocation;
+	lifetime_t* restrict lifetimes = span->scratch[0] = frame_alloc((n - i0) * sizeof *lifetimes);
+	// free masks, filled in by update_lifetimes2
+	span->scratch[1] = frame_alloc((n - i0) * sizeof(uint8_t));
 	for (int32_t i = 0; i < n - i0; ++i) {
 		const int32_t j = update_list.indices[i + i0];
 		memcpy(lifetimes + i, components[j * NUM_COMPONENTS + LIFETIME], sizeof(lifetime_t));
 	}
-	return NULL;
+	TRACE_END(__func__, span->i, span->n);
+	return 0;
 }
 
-static void* update_lifetimesp(void* args)
+static int update_lifetimes2(void* args)
 {
+	TRACE_BEGIN();
 	const span_t* span = args;
 	const int32_t i0 = span->i;
 	const int32_t n = span->n;
 	const float delta = span->delta;
-	const int32_t scratch = span->scratch;
-	lifetime_t* restrict lifetimes = scratch_arenas[scratch].allocation;
-	uint8_t* restrict free_masks = scratch_arenas[scratch + 1].allocation;
-	for (int32_t i = 0; i < n - i0; ++i)
-	{
-		lifetimes[i].value -= delta;
-		free_masks[i] = (lifetimes[i].bits >> 31) << FREE_ENTITY;
-	}
-	return NULL;
+	lifetime_t* restrict lifetimes = span->scratch[0];
+	uint8_t* restrict free_masks = span->scratch[1];
+	simd_decay(lifetimes, free_masks, n - i0, delta);
+	TRACE_END(__func__, span->i, span->n);
+	return 0;
 }
 
-static void* sync_lifetimesp(void* args)
+static int sync_lifetimes2(void* args)
 {
+	TRACE_BEGIN();
 	const span_t* span = args;
 	const int32_t i0 = span->i;
 	const int32_t n = span->n;
-	const lifetime_t* restrict lifetimes = scratch_arenas[span->scratch].allocation;
+	const lifetime_t* restrict lifetimes = span->scratch[0];
 	void** components = span->components;
 	for (int32_t i = 0; i < n - i0; ++i)
 	{
 		const int32_t j = update_list.indices[i + i0];
 		memcpy(components[j * NUM_COMPONENTS + LIFETIME], lifetimes + i, sizeof(lifetime_t));
 	}
-	return NULL;
+	TRACE_END(__func__, span->i, span->n);
+	return 0;
 }
 
-static void* sync_free_entity_flagsp(void* args)
+static int sync_free_entity_flags2(void* args)
 {
+	TRACE_BEGIN();
 	const span_t* span = args;
 	const int32_t i0 = span->i;
 	const int32_t n = span->n;
-	const uint8_t* restrict flags = scratch_arenas[span->scratch + 1].allocation;
-	uint8_t* bitmasks = span->bitmasks;
+	const uint8_t* restrict flags = span->scratch[1];
+	signature_t* bitmasks = span->bitmasks;
 	for (int32_t i = 0; i < n - i0; ++i)
 	{
 		const int32_t j = update_list.indices[i + i0];
-		bitmasks[j] |= flags[i];
+		signature_flag(bitmasks + j, FREE_ENTITY, flags[i]);
 	}
-	return NULL;
+	TRACE_END(__func__, span->i, span->n);
+	return 0;
 }
 
-int32_t multi_pthread_tick(ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
+static int32_t staged_tick(ecs_table_t* ecs_table, const float delta, const int32_t num_threads, launch_t launch)
 {
-	/* thrd_t* threads = alloca(num_threads * sizeof *threads); */
-	/* int t_res; */
-	pthread_t* threads = alloca(num_threads * sizeof *threads);
-	uint8_t* bitmasks = ecs_table->bitmasks;
+	frame_begin();
+	signature_t* bitmasks = ecs_table->bitmasks;
 	void** components = ecs_table->components;
-	uint8_t mask = 1 << FREE_ENTITY;
-	update_list.size = 0;
-	for (int32_t i = 0; i < ecs_table->size; ++i)
-	{
-		if (bitmasks[i] & mask)
-		{
-			mark_update(i);
-		}
-	}
+	PROFILE_PHASE_BEGIN(PROFILE_DESTROY_SCAN);
+	signature_t mask = SIGNATURE(FREE_ENTITY);
+	filter_update_list(ecs_table, mask, num_threads, launch);
+	PROFILE_PHASE_END(PROFILE_DESTROY_SCAN, ecs_table->size);
 	if (update_list.size > 0)
 	{
 		const int32_t n = update_list.size;
-		scratch_index = 0;
-		if (num_threads >= NUM_COMPONENTS)
+		PROFILE_DESTROYED(n);
+		PROFILE_PHASE_BEGIN(PROFILE_POOL_FREE);
+		free_args_t* args = alloca(NUM_COMPONENTS * sizeof *args);
+		for (int32_t i = 0; i < NUM_COMPONENTS; ++i)
 		{
-			/* free_args_t* args = alloca(NUM_COMPONENTS * sizeof *args); */
-			for (int8_t i = 0; i < NUM_COMPONENTS; ++i)
-			{
-				free_args_t* args = scratch_checkout(sizeof(free_args_t));
-				args->components = components;
-				args->c = i;
-				pthread_create(threads + i, &attr, free_componentsp, args);
-			}
-			for (int8_t i = 0; i < NUM_COMPONENTS; ++i)
-			{
-				pthread_join(threads[i], NULL);
-			}
+			args[i].ecs_table = ecs_table;
+			args[i].c = i;
 		}
-		else
+		// one thread per pool, short of that the caller frees them all
+		if (num_threads >= NUM_COMPONENTS)
 		{
-			// lol. lmao even.
+			launch(free_components, args, sizeof *args, NUM_COMPONENTS);
 		}
-		const size_t sizeof_components = NUM_COMPONENTS * sizeof(void*);
-		for (int32_t i = n - 1;  i >= 0; --i)
+		else
 		{
-			const int32_t j = update_list.indices[i];
-			const int32_t m = --ecs_table->size;
-			if (j < m)
+			for (int32_t i = 0; i < NUM_COMPONENTS; ++i)
 			{
-				bitmasks[j] = bitmasks[m];
-				memcpy(components + j * NUM_COMPONENTS, components + m * NUM_COMPONENTS, sizeof_components);
+				free_components(args + i);
 			}
 		}
-	}
-	mask = (1 << POSITION) | (1 << VELOCITY);
-	update_list.size = 0;
-	for (int32_t i = 0; i < ecs_table->size; ++i)
-	{
-		if ((bitmasks[i] & mask) == mask)
+		PROFILE_PHASE_END(PROFILE_POOL_FREE, n);
+		PROFILE_PHASE_BEGIN(PROFILE_COMPACT);
+		for (int32_t i = n - 1;  i >= 0; --i)
 		{
-			mark_update(i);
+			swap_remove(ecs_table, update_list.indices[i]);
 		}
+		PROFILE_PHASE_END(PROFILE_COMPACT, n);
 	}
+	PROFILE_PHASE_BEGIN(PROFILE_MOVEMENT);
+	mask = SIGNATURE(POSITION, VELOCITY);
+	filter_update_list(ecs_table, mask, num_threads, launch);
 	if (update_list.size > 0)
 	{
 		const int32_t n = update_list.size;
-		scratch_index = 0;
 		span_t* spans = alloca(num_threads * sizeof *spans);
 		set_spans(spans, num_threads, n);
-		for (int8_t i = 0; i < num_threads; ++i)
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].components = components;
-			spans[i].scratch = 2 * i;
-			const int32_t m = spans[i].n - spans[i].i;
-			scratch_checkout(m  * sizeof(velocity_t));
-			scratch_checkout(m  * sizeof(position_t));
-			pthread_create(threads + i, &attr, populate_position_update_buffersp, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			pthread_join(threads[i], NULL);
 		}
-		for (int8_t i = 0; i < num_threads; ++i)
+		launch(populate_position_update_buffers2, spans, sizeof *spans, num_threads);
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].delta = delta;
-			pthread_create(threads + i, &attr, update_positionsp, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			pthread_join(threads[i], NULL);
 		}
-		for (int8_t i = 0; i < num_threads; ++i)
+		launch(update_positions2, spans, sizeof *spans, num_threads);
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].components = components;
-			pthread_create(threads + i, &attr, sync_positionsp, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			pthread_join(threads[i], NULL);
-		}
-	}
-	mask = 1 << LIFETIME;
-	update_list.size = 0;
-	for (int32_t i = 0; i < ecs_table->size; ++i)
-	{
-		if (bitmasks[i] & mask)
-		{
-			mark_update(i);
 		}
+		launch(sync_positions2, spans, sizeof *spans, num_threads);
 	}
+	PROFILE_PHASE_END(PROFILE_MOVEMENT, update_list.size);
+	PROFILE_PHASE_BEGIN(PROFILE_LIFETIME);
+	mask = SIGNATURE(LIFETIME);
+	filter_update_list(ecs_table, mask, num_threads, launch);
 	if (update_list.size > 0)
 	{
 		const int32_t n = update_list.size;
-		scratch_index = 0;
 		span_t* spans = alloca(num_threads * sizeof *spans);
 		set_spans(spans, num_threads, n);
-		for (int8_t i = 0; i < num_threads; ++i)
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].components = components;
-			spans[i].scratch = 2 * i;
-			const int32_t m = spans[i].n - spans[i].i;
-			scratch_checkout(m * sizeof(lifetime_t));
-			scratch_checkout(m * sizeof(uint8_t));
-			pthread_create(threads + i, &attr, populate_lifetime_update_bufferp, spans + i);
 		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			pthread_join(threads[i], NULL);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
+		launch(populate_lifetime_update_buffer2, spans, sizeof *spans, num_threads);
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].delta = delta;
-			pthread_create(threads + i, &attr, update_lifetimesp, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			pthread_join(threads[i], NULL);
 		}
-		for (int8_t i = 0; i < num_threads; ++i)
+		launch(update_lifetimes2, spans, sizeof *spans, num_threads);
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].components = components;
-			pthread_create(threads + i, &attr, sync_lifetimesp, spans + i);
 		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			pthread_join(threads[i], NULL);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
+		launch(sync_lifetimes2, spans, sizeof *spans, num_threads);
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].bitmasks = bitmasks;
-			pthread_create(threads + i, &attr, sync_free_entity_flagsp, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			pthread_join(threads[i], NULL);
 		}
+		launch(sync_free_entity_flags2, spans, sizeof *spans, num_threads);
 	}
+	PROFILE_PHASE_END(PROFILE_LIFETIME, update_list.size);
+	VALIDATE_TICK(ecs_table);
 	return ecs_table->size;
 }
 
+int32_t multi_thread_tick2(ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
+{
+	PROFILE_TICK_BEGIN(__func__);
+	const int32_t size = staged_tick(ecs_table, delta, num_threads, launch_threads);
+	PROFILE_TICK_END();
+	return size;
+}
+
+int32_t multi_thread_tick2_workers(ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
+{
+	workers_init(num_threads);
+	PROFILE_TICK_BEGIN(__func__);
+	const int32_t size = staged_tick(ecs_table, delta, num_threads, workers_run);
+	PROFILE_TICK_END();
+	return size;
+}
+
+
+/*****************/
+/* POSIX THREADS */
+/*****************/
+
+// launch_threads on POSIX threads with the scheduling attributes from init_ecs
+static void launch_pthreads(thrd_start_t func, void* args, const size_t stride, const int32_t count)
+{
+	pthread_t* threads = alloca(count * sizeof *threads);
+	launch_item_t* items = alloca(count * sizeof *items);
+	for (int32_t i = 0; i < count; ++i)
+	{
+		items[i] = (launch_item_t){ func, (uint8_t*)args + i * stride, i };
+		pthread_create(threads + i, &attr, run_pthread_item, items + i);
+		numa_pin(threads[i], i, count);
+	}
+	for (int32_t i = 0; i < count; ++i)
+	{
+		pthread_join(threads[i], NULL);
+	}
+}
+
+int32_t multi_pthread_tick(ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
+{
+	PROFILE_TICK_BEGIN(__func__);
+	const int32_t size = staged_tick(ecs_table, delta, num_threads, launch_pthreads);
+	PROFILE_TICK_END();
+	return size;
+}
+
 
 /***********************/
 /* alt multi-threading */
@@ -1186,22 +1608,22 @@ int32_t multi_pthread_tick(ecs_table_t* ecs_table, const float delta, const int3
 
 static int thicc_funcc(void* args)
 {
+	TRACE_BEGIN();
 	const span_t* span = args;
 	const int32_t i0 = span->i;
 	const int32_t n = span->n;
-	const int32_t scratch_offset = span->scratch;
 	const ecs_table_t* ecs_table = span->ecs_table;
 	void** components = ecs_table->components;
-	uint8_t* bitmasks = ecs_table->bitmasks;
-	const int32_t num = ecs_table->size;
-	uint8_t mask = (1 << POSITION) | (1 << VELOCITY);
+	signature_t* bitmasks = ecs_table->bitmasks;
+	signature_t mask = SIGNATURE(POSITION, VELOCITY);
 	int32_t swap = 0;
-	position_t* position = scratch_alloc(scratch_offset, num * sizeof(position_t));
-	velocity_t* velocity = scratch_alloc(scratch_offset + 1, num * sizeof(velocity_t));
+	// the position buffer holds lifetimes later on, those are smaller
+	position_t* position = frame_alloc((n - i0) * sizeof *position);
+	velocity_t* velocity = frame_alloc((n - i0) * sizeof *velocity);
 	/* for (int32_t i = i0; i < num; ++i) // THIS IS THE PROBLEM!!! */
 	for (int32_t i = i0; i < n; ++i)
 	{
-		if ((bitmasks[i] & mask) == mask)
+		if (signature_has(bitmasks[i], mask))
 		{
 			memcpy(position + swap, components[i * NUM_COMPONENTS + POSITION], sizeof(position_t));
 			memcpy(velocity + swap, components[i * NUM_COMPONENTS + VELOCITY], sizeof(velocity_t));
@@ -1218,19 +1640,20 @@ static int thicc_funcc(void* args)
 	swap = 0;
 	for (int32_t i = i0; i < n; ++i)
 	{
-		if ((bitmasks[i] & mask) == mask)
+		if (signature_has(bitmasks[i], mask))
 		{
 			memcpy(components[i * NUM_COMPONENTS + POSITION], position + swap, sizeof(position_t));
 			memcpy(components[i * NUM_COMPONENTS + VELOCITY], velocity + swap, sizeof(velocity_t));
 			++swap;
 		}
 	}
-	mask = 1 << LIFETIME;
+	mask = SIGNATURE(LIFETIME);
 	swap = 0;
-	lifetime_t* lifetime = scratch_alloc(scratch_offset, num * sizeof(lifetime_t));
+	// positions are done with, reuse their buffer
+	lifetime_t* lifetime = (lifetime_t*)position;
 	for (int32_t i = i0; i < n; ++i)
 	{
-		if (bitmasks[i] & mask)
+		if (signature_has(bitmasks[i], mask))
 		{
 			memcpy(lifetime + swap, components[i * NUM_COMPONENTS + LIFETIME], sizeof(lifetime_t));
 			++swap;
@@ -1243,104 +1666,94 @@ static int thicc_funcc(void* args)
 	swap = 0;
 	for (int32_t i = i0; i < n; ++i)
 	{
-		if (bitmasks[i] & mask)
+		if (signature_has(bitmasks[i], mask))
 		{
 			memcpy(components[i * NUM_COMPONENTS + LIFETIME], lifetime + swap, sizeof(lifetime_t));
-			bitmasks[i] |= (lifetime[swap].bits >> 31) << FREE_ENTITY;
+			signature_flag(bitmasks + i, FREE_ENTITY, lifetime[swap].bits >> 31);
 			++swap;
 		}
 	}
+	TRACE_END(__func__, i0, n);
 	return 0;
 }
 
-int32_t multi_thread_tick_alt(ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
+static int32_t thicc_tick(ecs_table_t* ecs_table, const float delta, const int32_t num_threads, launch_t launch)
 {
-	thrd_t* threads = alloca(num_threads * sizeof *threads);
-	int t_res;
-	uint8_t* bitmasks = ecs_table->bitmasks;
-	void** components = ecs_table->components;
-	uint8_t mask = 1 << FREE_ENTITY;
-	update_list.size = 0;
-	for (int32_t i = 0; i < ecs_table->size; ++i)
-	{
-		if (bitmasks[i] & mask)
-		{
-			mark_update(i);
-		}
-	}
+	frame_begin();
+	PROFILE_PHASE_BEGIN(PROFILE_DESTROY_SCAN);
+	const signature_t mask = SIGNATURE(FREE_ENTITY);
+	filter_update_list(ecs_table, mask, num_threads, launch);
+	PROFILE_PHASE_END(PROFILE_DESTROY_SCAN, ecs_table->size);
 	if (update_list.size > 0)
 	{
 		const int32_t n = update_list.size;
-		if (num_threads >= NUM_COMPONENTS)
-		{
-			free_args_t* args = alloca(NUM_COMPONENTS * sizeof *args);
-			for (int8_t i = 0; i < NUM_COMPONENTS; ++i)
-			{
-				args[i].components = components;
-				args[i].c = i;
-				thrd_create(threads + i, free_components, args + i);
-			}
-			for (int8_t i = 0; i < NUM_COMPONENTS; ++i)
-			{
-				thrd_join(threads[i], &t_res);
-			}
-		}
-		else
+		PROFILE_DESTROYED(n);
+		PROFILE_PHASE_BEGIN(PROFILE_POOL_FREE);
+		free_args_t* args = alloca(NUM_COMPONENTS * sizeof *args);
+		for (int32_t i = 0; i < NUM_COMPONENTS; ++i)
 		{
-			// lol. lmao even.
+			args[i].ecs_table = ecs_table;
+			args[i].c = i;
 		}
-		const size_t sizeof_components = NUM_COMPONENTS * sizeof(void*);
+		launch(free_components, args, sizeof *args, NUM_COMPONENTS);
+		PROFILE_PHASE_END(PROFILE_POOL_FREE, n);
+		PROFILE_PHASE_BEGIN(PROFILE_COMPACT);
 		for (int32_t i = n - 1;  i >= 0; --i)
 		{
-			const int32_t j = update_list.indices[i];
-			const int32_t m = --ecs_table->size;
-			if (j < m)
-			{
-				bitmasks[j] = bitmasks[m];
-				memcpy(components + j * NUM_COMPONENTS, components + m * NUM_COMPONENTS, sizeof_components);
-			}
+			swap_remove(ecs_table, update_list.indices[i]);
 		}
+		PROFILE_PHASE_END(PROFILE_COMPACT, n);
 	}
 	if (ecs_table->size > 0)
 	{
+		PROFILE_PHASE_BEGIN(PROFILE_UPDATE);
 		tick_delta = delta;
-		const int32_t n = ecs_table->size;
 		span_t* spans = alloca(num_threads * sizeof *spans);
 		set_spans(spans, num_threads, ecs_table->size);
-		for (int8_t i = 0; i < num_threads; ++i)
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].ecs_table = ecs_table;
-			spans[i].scratch = 2 * i;
-			thrd_create(threads + i, thicc_funcc, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
 		}
-
+		launch(thicc_funcc, spans, sizeof *spans, num_threads);
+		PROFILE_PHASE_END(PROFILE_UPDATE, ecs_table->size);
 	}
+	VALIDATE_TICK(ecs_table);
 	return ecs_table->size;
 }
 
+int32_t multi_thread_tick_alt(ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
+{
+	PROFILE_TICK_BEGIN(__func__);
+	const int32_t size = thicc_tick(ecs_table, delta, num_threads, launch_threads);
+	PROFILE_TICK_END();
+	return size;
+}
+
+int32_t multi_thread_tick_alt_workers(ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
+{
+	workers_init(num_threads);
+	PROFILE_TICK_BEGIN(__func__);
+	const int32_t size = thicc_tick(ecs_table, delta, num_threads, workers_run);
+	PROFILE_TICK_END();
+	return size;
+}
+
 
 /************/
 /* ALT HELL */
 /************/
 
-static int the_funk(void* args)
+static void funk_range(void* ctx, const int32_t i0, const int32_t n)
 {
-	const span_t* span = args;
-	const int32_t i0 = span->i;
-	const int32_t n = span->n;
-	const ecs_table_t* ecs_table = span->ecs_table;
+	TRACE_BEGIN();
+	const ecs_table_t* ecs_table = ctx;
 	void** components = ecs_table->components;
-	uint8_t* bitmasks = ecs_table->bitmasks;
-	const int32_t num = ecs_table->size;
-	const uint8_t pos_mask = (1 << POSITION) | (1 << VELOCITY);
-	const uint8_t life_mask = (1 << LIFETIME);
+	signature_t* bitmasks = ecs_table->bitmasks;
+	const signature_t pos_mask = SIGNATURE(POSITION, VELOCITY);
+	const signature_t life_mask = SIGNATURE(LIFETIME);
 	for (int32_t i = i0; i < n; ++i)
 	{
-		if ((bitmasks[i] & pos_mask) == pos_mask)
+		if (signature_has(bitmasks[i], pos_mask))
 		{
 			position_t* p = components[i * NUM_COMPONENTS + POSITION];
 			const velocity_t v = *(velocity_t*)components[i * NUM_COMPONENTS + VELOCITY];
@@ -1348,32 +1761,37 @@ static int the_funk(void* args)
 			p->y += tick_delta * v.y;
 			p->z += tick_delta * v.z;
 		}
-		if (bitmasks[i] & life_mask)
+		if (signature_has(bitmasks[i], life_mask))
 		{
 			lifetime_t* l = components[i * NUM_COMPONENTS + LIFETIME];
 			l->value -= tick_delta;
-			bitmasks[i] |= (l->bits >> 31) << FREE_ENTITY;
+			signature_flag(bitmasks + i, FREE_ENTITY, l->bits >> 31);
 		}
 	}
+	TRACE_END(__func__, i0, n);
+}
+
+static int the_funk(void* args)
+{
+	const span_t* span = args;
+	funk_range(span->ecs_table, span->i, span->n);
 	return 0;
 }
 
 
-int32_t multi_thread_tick_other_alt(ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
+// yeah this part is singly-threaded idgaf
+void ecs_destroy_free_entities(ecs_table_t* ecs_table)
 {
-	thrd_t* threads = alloca(num_threads * sizeof *threads);
-	int t_res;
-	uint8_t* bitmasks = ecs_table->bitmasks;
+	signature_t* bitmasks = ecs_table->bitmasks;
 	void** components = ecs_table->components;
-	// yeah this part is singly-threaded idgaf
 	if (ecs_table->size > 0)
 	{
+		PROFILE_PHASE_BEGIN(PROFILE_DESTROY);
 		const int32_t n = ecs_table->size;
-		const size_t sizeof_components = NUM_COMPONENTS * sizeof(void*);
-		const uint8_t mask = 1 << FREE_ENTITY;
+		const signature_t mask = SIGNATURE(FREE_ENTITY);
 		for (int32_t i = n - 1; i >= 0; --i)
 		{
-			if ((bitmasks[i] & mask) == 0x00)
+			if (!signature_has(bitmasks[i], mask))
 			{
 				// bp abuse lmao
 				continue;
@@ -1381,35 +1799,77 @@ int32_t multi_thread_tick_other_alt(ecs_table_t* ecs_table, const float delta, c
 			else
 			{
 				const int32_t k = i * NUM_COMPONENTS;
-				for (int8_t j = 0; j < NUM_COMPONENTS; ++j)
-				{
-					pool_free(component_pools + j, components[k + j]);
-				}
-				const int32_t m = --ecs_table->size;
-				if (i < m)
+				for (int32_t j = 0; j < NUM_COMPONENTS; ++j)
 				{
-					bitmasks[i] = bitmasks[m];
-					memcpy(components + k, components + m * NUM_COMPONENTS, sizeof_components);
+					if (signature_test(bitmasks[i], j))
+					{
+						cpool_free(component_pools + j, components[k + j]);
+					}
 				}
+				swap_remove(ecs_table, i);
 			}
 		}
+		PROFILE_DESTROYED(n - ecs_table->size);
+		PROFILE_PHASE_END(PROFILE_DESTROY, n);
 	}
+}
+
+static int32_t funk_tick(ecs_table_t* ecs_table, const float delta, const int32_t num_threads, launch_t launch)
+{
+	ecs_destroy_free_entities(ecs_table);
 	if (ecs_table->size > 0)
 	{
+		PROFILE_PHASE_BEGIN(PROFILE_UPDATE);
 		tick_delta = delta;
 		const int32_t n = ecs_table->size;
 		span_t* spans = alloca(num_threads * sizeof *spans);
 		set_spans(spans, num_threads, n);
-		for (int8_t i = 0; i < num_threads; ++i)
+		for (int32_t i = 0; i < num_threads; ++i)
 		{
 			spans[i].ecs_table = ecs_table;
-			thrd_create(threads + i, the_funk, spans + i);
-		}
-		for (int8_t i = 0; i < num_threads; ++i)
-		{
-			thrd_join(threads[i], &t_res);
 		}
+		launch(the_funk, spans, sizeof *spans, num_threads);
+		PROFILE_PHASE_END(PROFILE_UPDATE, n);
 	}
+	VALIDATE_TICK(ecs_table);
+	return ecs_table->size;
+}
+
+int32_t multi_thread_tick_other_alt(ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
+{
+	PROFILE_TICK_BEGIN(__func__);
+	const int32_t size = funk_tick(ecs_table, delta, num_threads, launch_threads);
+	PROFILE_TICK_END();
+	return size;
+}
+
+int32_t multi_thread_tick_other_alt_workers(ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
+{
+	workers_init(num_threads);
+	PROFILE_TICK_BEGIN(__func__);
+	const int32_t size = funk_tick(ecs_table, delta, num_threads, workers_run);
+	PROFILE_TICK_END();
+	return size;
+}
+
+/*****************/
+/* work-stealing */
+/*****************/
+
+// entities per leaf range, small enough to rebalance, big enough to amortize a steal
+#define STEAL_GRAIN 2048
+
+int32_t multi_thread_tick_stealing(ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
+{
+	workers_init(num_threads);
+	PROFILE_TICK_BEGIN(__func__);
+	ecs_destroy_free_entities(ecs_table);
+	PROFILE_PHASE_BEGIN(PROFILE_UPDATE);
+	tick_delta = delta;
+	ecs_parallel_for(ecs_table->size, STEAL_GRAIN, funk_range, ecs_table);
+	PROFILE_PHASE_END(PROFILE_UPDATE, ecs_table->size);
+	VALIDATE_TICK(ecs_table);
+	PROFILE_TICK_END();
 	return ecs_table->size;
 }
 
@@ -1417,51 +1877,170 @@ int32_t multi_thread_tick_other_alt(ecs_table_t* ecs_table, const float delta, c
 /* Just use OpenMP lol */
 /***********************/
 
-int32_t openmp_tick(ecs_table_t *ecs_table, const float delta) {
-  uint8_t *bitmasks = ecs_table->bitmasks;
+// parallel swap-remove.  After compaction the table holds size - dead entities, so every
+// dead entity below the new size (a hole) gets filled by a live entity at or above it
+// (a filler).  There are exactly as many of each, and the k-th filler goes into the k-th
+// hole, which makes every move independent of the others.
+static void openmp_destroy_free_entities(ecs_table_t *ecs_table) {
+  signature_t *bitmasks = ecs_table->bitmasks;
   void **components = ecs_table->components;
-  if (ecs_table->size > 0) {
-    const int32_t n = ecs_table->size;
-    const size_t sizeof_components = NUM_COMPONENTS * sizeof(void *);
-    const uint8_t mask = 1 << FREE_ENTITY;
-#pragma omp parallel for
-    for (int32_t i = n - 1; i >= 0; --i) {
-      if ((bitmasks[i] & mask) == 0x00) {
-        // bp abuse lmao
-        continue;
-      } else {
-        const int32_t k = i * NUM_COMPONENTS;
-        for (int8_t j = 0; j < NUM_COMPONENTS; ++j) {
-          pool_free(component_pools + j, components[k + j]);
-        }
-        const int32_t m = --ecs_table->size;
-        if (i < m) {
-          bitmasks[i] = bitmasks[m];
-          memcpy(components + k, components + m * NUM_COMPONENTS,
-                 sizeof_components);
+  const int32_t n = ecs_table->size;
+  const signature_t mask = SIGNATURE(FREE_ENTITY);
+  int32_t num_dead = 0;
+  PROFILE_PHASE_BEGIN(PROFILE_DESTROY_SCAN);
+#pragma omp parallel for reduction(+ : num_dead)
+  for (int32_t i = 0; i < n; ++i) {
+    num_dead += signature_test(bitmasks[i], FREE_ENTITY);
+  }
+  if (num_dead == 0) {
+    PROFILE_PHASE_END(PROFILE_DESTROY_SCAN, n);
+    return;
+  }
+  PROFILE_DESTROYED(num_dead);
+  const int32_t new_size = n - num_dead;
+  int32_t *dead = update_list.indices;
+  int32_t *holes = frame_alloc(2 * num_dead * sizeof(int32_t));
+  int32_t *fillers = holes + num_dead;
+  // per thread dead/hole/filler counts, scanned into offsets
+  int32_t *offsets = alloca(3 * (omp_get_max_threads() + 1) * sizeof *offsets);
+  int32_t num_holes = 0;
+#pragma omp parallel
+  {
+    const int32_t t = omp_get_thread_num();
+    const int32_t num_threads = omp_get_num_threads();
+    const int32_t i0 = (int64_t)n * t / num_threads;
+    const int32_t i1 = (int64_t)n * (t + 1) / num_threads;
+    // mark: count per thread
+    int32_t d = 0, h = 0, f = 0;
+    for (int32_t i = i0; i < i1; ++i) {
+      const int32_t is_dead = signature_has(bitmasks[i], mask);
+      d += is_dead;
+      h += is_dead & (i < new_size);
+      f += !is_dead & (i >= new_size);
+    }
+    offsets[3 * (t + 1)] = d;
+    offsets[3 * (t + 1) + 1] = h;
+    offsets[3 * (t + 1) + 2] = f;
+#pragma omp barrier
+    // exclusive scan
+#pragma omp single
+    {
+      offsets[0] = offsets[1] = offsets[2] = 0;
+      for (int32_t k = 3; k < 3 * (num_threads + 1); ++k) {
+        offsets[k] += offsets[k - 3];
+      }
+      num_holes = offsets[3 * num_threads + 1];
+    }
+    // scatter
+    d = offsets[3 * t];
+    h = offsets[3 * t + 1];
+    f = offsets[3 * t + 2];
+    for (int32_t i = i0; i < i1; ++i) {
+      if (signature_has(bitmasks[i], mask)) {
+        dead[d++] = i;
+        if (i < new_size) {
+          holes[h++] = i;
         }
+      } else if (i >= new_size) {
+        fillers[f++] = i;
       }
     }
   }
-  if (ecs_table->size > 0) {
-    const int32_t n = ecs_table->size;
-    const uint8_t pos_mask = (1 << POSITION) | (1 << VELOCITY);
-    const uint8_t l_mask = 1 << LIFETIME;
+  PROFILE_PHASE_END(PROFILE_DESTROY_SCAN, n);
+  // batched returns, the pools are thread-safe so each thread frees its share of the dead
+  PROFILE_PHASE_BEGIN(PROFILE_POOL_FREE);
 #pragma omp parallel for
-    for (int32_t i = 0; i < n; ++i) {
-      if ((bitmasks[i] & pos_mask) == pos_mask) {
-        position_t *p = components[i * NUM_COMPONENTS + POSITION];
-        velocity_t v = *(velocity_t *)components[i * NUM_COMPONENTS + VELOCITY];
-        p->x += delta * v.x;
-        p->y += delta * v.y;
-        p->z += delta * v.z;
+  for (int32_t i = 0; i < num_dead; ++i) {
+    const int32_t j = dead[i];
+    for (int32_t c = 0; c < NUM_COMPONENTS; ++c) {
+      if (signature_test(bitmasks[j], c)) {
+        cpool_free(component_pools + c, components[j * NUM_COMPONENTS + c]);
       }
-      if (bitmasks[i] & l_mask) {
-        lifetime_t *l = components[i * NUM_COMPONENTS + LIFETIME];
-        l->value -= delta;
-        bitmasks[i] |= (l->bits >> 31) << FREE_ENTITY;
+    }
+  }
+  PROFILE_PHASE_END(PROFILE_POOL_FREE, num_dead);
+  // retire the dead handles
+  PROFILE_PHASE_BEGIN(PROFILE_COMPACT);
+  int32_t *slots = ecs_table->slots;
+  int32_t *dense_of = ecs_table->dense;
+  uint32_t *generations = ecs_table->generations;
+#pragma omp parallel for
+  for (int32_t i = 0; i < num_dead; ++i) {
+    ++generations[slots[dead[i]]];
+  }
+  // the match lists get fixed up serially, drop the dead first so the holes are free
+  if (ecs_table->num_queries > 0) {
+    for (int32_t i = 0; i < num_dead; ++i) {
+      queries_erase(ecs_table, dead[i]);
+    }
+    for (int32_t k = 0; k < num_holes; ++k) {
+      queries_move(ecs_table, holes[k], fillers[k]);
+    }
+  }
+  // compact
+  const size_t sizeof_components = NUM_COMPONENTS * sizeof(void *);
+#pragma omp parallel for
+  for (int32_t k = 0; k < num_holes; ++k) {
+    const int32_t j = holes[k];
+    const int32_t m = fillers[k];
+    const int32_t hole_slot = slots[j];
+    const int32_t filler_slot = slots[m];
+    bitmasks[j] = bitmasks[m];
+    memcpy(components + j * NUM_COMPONENTS, components + m * NUM_COMPONENTS,
+           sizeof_components);
+    slots[j] = filler_slot;
+    slots[m] = hole_slot;
+    dense_of[filler_slot] = j;
+    dense_of[hole_slot] = m;
+  }
+  ecs_table->size = new_size;
+  PROFILE_PHASE_END(PROFILE_COMPACT, num_dead);
+}
+
+int32_t openmp_tick(ecs_table_t *ecs_table, const float delta) {
+  numa_pin_openmp();
+  PROFILE_TICK_BEGIN(__func__);
+  frame_begin();
+  signature_t *bitmasks = ecs_table->bitmasks;
+  void **components = ecs_table->components;
+  if (ecs_table->size > 0) {
+    openmp_destroy_free_entities(ecs_table);
+  }
+  if (ecs_table->size > 0) {
+    const int32_t n = ecs_table->size;
+    const signature_t pos_mask = SIGNATURE(POSITION, VELOCITY);
+    const signature_t l_mask = SIGNATURE(LIFETIME);
+    PROFILE_PHASE_BEGIN(PROFILE_UPDATE);
+    // no barrier in the loop, each thread's busy time stops at its last entity
+#pragma omp parallel
+    {
+      PROFILE_BUSY_BEGIN();
+      TRACE_BEGIN();
+      // schedule(static) by hand so the trace knows each thread's slice
+      const int32_t t = omp_get_thread_num();
+      const int32_t num_threads = omp_get_num_threads();
+      const int32_t i0 = (int64_t)n * t / num_threads;
+      const int32_t i1 = (int64_t)n * (t + 1) / num_threads;
+      for (int32_t i = i0; i < i1; ++i) {
+        if (signature_has(bitmasks[i], pos_mask)) {
+          position_t *p = components[i * NUM_COMPONENTS + POSITION];
+          velocity_t v = *(velocity_t *)components[i * NUM_COMPONENTS + VELOCITY];
+          p->x += delta * v.x;
+          p->y += delta * v.y;
+          p->z += delta * v.z;
+        }
+        if (signature_has(bitmasks[i], l_mask)) {
+          lifetime_t *l = components[i * NUM_COMPONENTS + LIFETIME];
+          l->value -= delta;
+          signature_flag(bitmasks + i, FREE_ENTITY, l->bits >> 31);
+        }
       }
+      TRACE_END("openmp_update", i0, i1);
+      PROFILE_BUSY_END(t);
     }
+    PROFILE_PHASE_END(PROFILE_UPDATE, n);
   }
+  VALIDATE_TICK(ecs_table);
+  PROFILE_TICK_END();
   return ecs_table->size;
 }
@@ -3,10 +3,18 @@
 
 #include <stdint.h>
 #include "components.h"
+#include "entity.h"
 
+// default capacity, tables take theirs at init
 // #define ENTITY_CAP 1048456
 #define ENTITY_CAP 65536
 /* #define ENTITY_CAP 1024 */
+// biggest capacity a table may ask for.  Component pools reserve address space for this
+// many and only commit what gets used.
+#define ECS_MAX_ENTITIES (1 << 24)
+// threads that may spawn or destroy concurrently, each can strand a magazine of components
+#define ECS_MAX_THREADS 256
+#define ECS_MAX_QUERIES 32
 
     typedef enum __attribute__((packed)) component_t {
 #define X(A,...) A,
@@ -15,29 +23,258 @@
           NUM_COMPONENTS
     } component_t;
 
+// bit flagged by the lifetime system, entity gets destroyed next tick
+#define FREE_ENTITY NUM_COMPONENTS
+
+// one bit per component plus FREE_ENTITY.  Picks the narrowest integer that fits so the
+// mask scans stay dense, past 63 components it turns into a bitset of 64 bit words.
+#define X(...) +1
+#if (0 COMPONENTS) < 8
+typedef uint8_t signature_t;
+#elif (0 COMPONENTS) < 16
+typedef uint16_t signature_t;
+#elif (0 COMPONENTS) < 32
+typedef uint32_t signature_t;
+#elif (0 COMPONENTS) < 64
+typedef uint64_t signature_t;
+#else
+#define SIGNATURE_WORDS ((NUM_COMPONENTS + 64) / 64)
+typedef struct signature_t
+{
+	uint64_t words[SIGNATURE_WORDS];
+} signature_t;
+#endif
+#undef X
+
+#define SIGNATURE_EMPTY ((signature_t){0})
+// SIGNATURE(POSITION, VELOCITY), folds to a constant
+#define SIGNATURE(...) signature_from((const int32_t[]){ __VA_ARGS__ }, sizeof((const int32_t[]){ __VA_ARGS__ }) / sizeof(int32_t))
+
+#ifndef SIGNATURE_WORDS
+inline static int32_t signature_test(const signature_t sig, const int32_t bit)
+{
+	return (sig >> bit) & 1;
+}
+
+inline static void signature_set(signature_t* sig, const int32_t bit)
+{
+	*sig |= (signature_t)1 << bit;
+}
+
+inline static void signature_clear(signature_t* sig, const int32_t bit)
+{
+	*sig &= ~((signature_t)1 << bit);
+}
+
+// sets bit if flag is 1, no branch
+inline static void signature_flag(signature_t* sig, const int32_t bit, const uint32_t flag)
+{
+	*sig |= (signature_t)flag << bit;
+}
+
+inline static signature_t signature_or(const signature_t a, const signature_t b)
+{
+	return a | b;
+}
+
+// every bit of mask is set in sig
+inline static int32_t signature_has(const signature_t sig, const signature_t mask)
+{
+	return (sig & mask) == mask;
+}
+
+// some bit of mask is set in sig
+inline static int32_t signature_any(const signature_t sig, const signature_t mask)
+{
+	return (sig & mask) != 0;
+}
+
+inline static int32_t signature_eq(const signature_t a, const signature_t b)
+{
+	return a == b;
+}
+
+inline static uint32_t signature_hash(const signature_t sig)
+{
+	return ((uint64_t)sig * 0x9e3779b97f4a7c15ull) >> 32;
+}
+#else
+// fixed trip count word loops, the compiler unrolls or vectorizes them
+inline static int32_t signature_test(const signature_t sig, const int32_t bit)
+{
+	return (sig.words[bit / 64] >> (bit % 64)) & 1;
+}
+
+inline static void signature_set(signature_t* sig, const int32_t bit)
+{
+	sig->words[bit / 64] |= (uint64_t)1 << (bit % 64);
+}
+
+inline static void signature_clear(signature_t* sig, const int32_t bit)
+{
+	sig->words[bit / 64] &= ~((uint64_t)1 << (bit % 64));
+}
+
+inline static void signature_flag(signature_t* sig, const int32_t bit, const uint32_t flag)
+{
+	sig->words[bit / 64] |= (uint64_t)flag << (bit % 64);
+}
+
+inline static signature_t signature_or(const signature_t a, const signature_t b)
+{
+	signature_t res;
+	for (int32_t w = 0; w < SIGNATURE_WORDS; ++w)
+	{
+		res.words[w] = a.words[w] | b.words[w];
+	}
+	return res;
+}
+
+inline static int32_t signature_has(const signature_t sig, const signature_t mask)
+{
+	uint64_t missing = 0;
+	for (int32_t w = 0; w < SIGNATURE_WORDS; ++w)
+	{
+		missing |= mask.words[w] & ~sig.words[w];
+	}
+	return missing == 0;
+}
+
+inline static int32_t signature_any(const signature_t sig, const signature_t mask)
+{
+	uint64_t common = 0;
+	for (int32_t w = 0; w < SIGNATURE_WORDS; ++w)
+	{
+		common |= mask.words[w] & sig.words[w];
+	}
+	return common != 0;
+}
+
+inline static int32_t signature_eq(const signature_t a, const signature_t b)
+{
+	uint64_t diff = 0;
+	for (int32_t w = 0; w < SIGNATURE_WORDS; ++w)
+	{
+		diff |= a.words[w] ^ b.words[w];
+	}
+	return diff == 0;
+}
+
+inline static uint32_t signature_hash(const signature_t sig)
+{
+	uint64_t h = 0;
+	for (int32_t w = 0; w < SIGNATURE_WORDS; ++w)
+	{
+		h = (h ^ sig.words[w]) * 0x9e3779b97f4a7c15ull;
+	}
+	return h >> 32;
+}
+#endif
+
+inline static signature_t signature_from(const int32_t* bits, const int32_t n)
+{
+	signature_t sig = SIGNATURE_EMPTY;
+	for (int32_t i = 0; i < n; ++i)
+	{
+		signature_set(&sig, bits[i]);
+	}
+	return sig;
+}
+
 /* typedef struct entity_t entity_t; */
 
+// entities that have every component in all and none of the ones in none.  The match list
+// is kept up to date by the table as entities change, so iterating it costs no scan.
+typedef struct ecs_query_t
+{
+	signature_t all;
+	signature_t none;
+	int32_t* rows; // matching entity ids, in no particular order
+	int32_t* where; // entity id -> index in rows, -1 if it doesn't match
+	int32_t size;
+	int32_t committed;
+} ecs_query_t;
+
 typedef struct ecs_table_t
 {
 	void** components;
-	uint8_t* bitmasks;
+	signature_t* bitmasks;
+	// handle indirection, slots is a permutation of [0, committed) and
+	// dense is its inverse.  slots past size are the free handle slots.
+	int32_t* slots; // entity -> handle slot
+	int32_t* dense; // handle slot -> entity
+	uint32_t* generations; // handle slot -> generation, bumped on destroy
 	int32_t size;
+	// every array is reserved for capacity entities up front and committed as size
+	// grows, nothing ever moves so the tick loops don't have to care
+	int32_t capacity;
+	int32_t committed;
+	int32_t grow_lock;
+	int32_t query_lock; // match list upkeep from spawning threads
+	ecs_query_t* queries[ECS_MAX_QUERIES];
+	int32_t num_queries;
 } ecs_table_t;
 
+// capacity is the most entities the table will ever hold, memory is only committed as
+// they get spawned so overestimating is cheap
+void ecs_table_init(ecs_table_t* ecs_table, const int32_t capacity);
+
+void ecs_table_destroy(ecs_table_t* ecs_table);
+
+// drops every entity and invalidates their handles
+void ecs_table_clear(ecs_table_t* ecs_table);
+
+// NOTE: while a table has queries, activating entities and adding or removing components
+// stay thread-safe but take a lock per call to update the match lists, spawn in batches or
+// record into command buffers to keep it cheap.  Bits flipped straight in the bitmasks
+// aren't seen, so FREE_ENTITY can't be part of a query.
+ecs_query_t* ecs_query_create(ecs_table_t* ecs_table, const signature_t all, const signature_t none);
+
+void ecs_query_destroy(ecs_table_t* ecs_table, ecs_query_t* query);
+
+// entity ids move when something gets destroyed, handles don't
+entity_t ecs_entity_handle(const ecs_table_t* ecs_table, const int32_t id);
+
+// current id of the entity, -1 if it has been destroyed or was never handed out
+int32_t ecs_entity_index(const ecs_table_t* ecs_table, const entity_t entity);
+
 void ecs_free_all(void);
 
 int32_t ecs_activate_entity(ecs_table_t* ecs_table);
 
 void ecs_add_component(ecs_table_t* ecs_table, const int32_t id, const component_t component);
 
+// the entity has to have the component
+void ecs_remove_component(ecs_table_t* ecs_table, const int32_t id, const component_t component);
+
+// activates count entities in one contiguous range and gives each of them the components
+// in mask.  initializers is indexed by component_t, every entity gets a copy of
+// initializers[c] (zeros if it or initializers is NULL).  Returns the first id.
+int32_t ecs_spawn_batch(ecs_table_t* ecs_table, const int32_t count, const signature_t mask, const void* const* initializers);
+
 #define X(_, NAME) void ecs_set_##NAME(ecs_table_t* ecs_table, const int32_t id, const NAME##_t* value);
 COMPONENTS
 #undef X
 
+// frees and swap-removes every entity flagged with FREE_ENTITY
+void ecs_destroy_free_entities(ecs_table_t* ecs_table);
+
+// asserts the table invariants: bitmasks, component ownership and pool free lists.
+// Every table shares the pools, so it catches double frees but not leaks.
+// Runs after every tick when built with ECS_VALIDATE.
+void ecs_validate(const ecs_table_t* ecs_table);
+
 int32_t single_thread_tick(ecs_table_t* ecs_table, const float delta);
 
 int32_t single_thread_tick_alt(ecs_table_t* ecs_table, const float delta);
 
+// destroy, movement and lifetime fused into a single pass over the table
+int32_t single_thread_tick_fused(ecs_table_t* ecs_table, const float delta);
+
+// single_thread_tick with the entity lists coming from queries instead of bitmask scans,
+// movers wants POSITION and VELOCITY and agers LIFETIME
+int32_t single_thread_tick_query(ecs_table_t* ecs_table, const ecs_query_t* movers, const ecs_query_t* agers, const float delta);
+
 int32_t multi_thread_tick(ecs_table_t* ecs_table, const float delta, const int32_t num_threads);
 
 int32_t multi_thread_tick2(ecs_table_t* ecs_table, const float delta, const int32_t num_threads);
@@ -48,6 +285,18 @@ int32_t multi_thread_tick_alt(ecs_table_t* ecs_table, const float delta, const i
 
 int32_t multi_thread_tick_other_alt(ecs_table_t* ecs_table, const float delta, const int32_t num_threads);
 
+// same kernels as above, submitted to the persistent worker pool instead of fresh threads
+int32_t multi_thread_tick_workers(ecs_table_t* ecs_table, const float delta, const int32_t num_threads);
+
+int32_t multi_thread_tick2_workers(ecs_table_t* ecs_table, const float delta, const int32_t num_threads);
+
+int32_t multi_thread_tick_alt_workers(ecs_table_t* ecs_table, const float delta, const int32_t num_threads);
+
+int32_t multi_thread_tick_other_alt_workers(ecs_table_t* ecs_table, const float delta, const int32_t num_threads);
+
+// the_funk over a work-stealing parallel_for instead of static spans
+int32_t multi_thread_tick_stealing(ecs_table_t* ecs_table, const float delta, const int32_t num_threads);
+
 int32_t openmp_tick(ecs_table_t *ecs_table, const float delta);
 
 #endif /* End ECS_H */
@@ -3,9 +3,11 @@
 
 #include <stdint.h>
 
+// generational handle, stays valid across swap-removes and goes stale once the entity dies
 typedef struct entity_t
 {
-	int32_t id;
+	int32_t id; // handle slot, not the entity's index in the table
+	uint32_t generation;
 } entity_t;
 
 
@@ -0,0 +1,79 @@
+#include "fill.h"
+#include <stdlib.h>
+#include <string.h>
+#include <alloca.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// below this a plain memcpy fill stays in cache and wins
+#define STREAM_THRESHOLD (64 * 1024)
+
+inline static size_t gcd(size_t a, size_t b)
+{
+	while (b)
+	{
+		const size_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+// copy the value once, then keep doubling the filled prefix
+static void doubling_fill(uint8_t* dst, const size_t total, const void* value, const int32_t size)
+{
+	memcpy(dst, value, size);
+	size_t filled = size;
+	while (filled < total)
+	{
+		const size_t n = filled < total - filled ? filled : total - filled;
+		memcpy(dst + filled, dst, n);
+		filled += n;
+	}
+}
+
+void stream_fill(void* dst, const int32_t count, const void* value, const int32_t size)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	uint8_t* out = dst;
+	const uint8_t* v = value;
+	const size_t total = (size_t)count * size;
+#ifdef __SSE2__
+	if (total >= STREAM_THRESHOLD)
+	{
+		// bytes until out is 16 byte aligned
+		const size_t head = (16 - ((uintptr_t)out & 15)) & 15;
+		for (size_t k = 0; k < head; ++k)
+		{
+			out[k] = v[k % size];
+		}
+		// the value repeats every lcm(size, 16) bytes in 16 byte lanes, the extra 16
+		// bytes let every window be a single unaligned load
+		const size_t period = size / gcd(size, 16) * 16;
+		uint8_t* pattern = alloca(period + 16);
+		for (size_t k = 0; k < period + 16; ++k)
+		{
+			pattern[k] = v[(head + k) % size];
+		}
+		size_t k = head;
+		size_t phase = 0;
+		for (; k + 16 <= total; k += 16)
+		{
+			_mm_stream_si128((__m128i*)(out + k), _mm_loadu_si128((const __m128i*)(pattern + phase)));
+			phase += 16;
+			phase = phase == period ? 0 : phase;
+		}
+		for (; k < total; ++k)
+		{
+			out[k] = v[k % size];
+		}
+		_mm_sfence();
+		return;
+	}
+#endif
+	doubling_fill(out, total, value, size);
+}
@@ -0,0 +1,10 @@
+#ifndef FILL_H
+#define FILL_H
+
+#include <stdint.h>
+
+// writes count copies of the size byte value back to back at dst.  Big fills use
+// non-temporal SIMD stores since freshly spawned components won't be read until next tick.
+void stream_fill(void* dst, const int32_t count, const void* value, const int32_t size);
+
+#endif /* End FILL_H */
@@ -8,15 +8,38 @@
 #include <unistd.h>
 #endif
 #include "ecs.h"
+#include "soa.h"
+#include "archetype.h"
+#include "simd.h"
+#include "systems.h"
+#include "commands.h"
+#include "workers.h"
 
+#define HANDLES
 #define SINGLE
 #define ALT_SINGLE
+#define FUSED_SINGLE
+#define QUERY_SINGLE
 #define MULTITHREAD
 #define MULTITHREAD2
 #define POSIXTHREADS
 #define ALT_THREAD
 #define OTHER_ALT_THREAD
+#define WORKER_THREAD
+#define WORKER_THREAD2
+#define ALT_WORKER_THREAD
+#define OTHER_ALT_WORKER_THREAD
+#define STEALING_THREAD
+#define SYSTEMS
+#define COMMANDS
 #define OpenMP
+#define OpenMP_SPAWN
+#define OpenMP_BATCH
+#define SOA
+#define SOA_OpenMP
+#define SOA_BATCH
+#define ARCHETYPE
+#define ARCHETYPE_OpenMP
 
 /* #define N 100000 */
 #define N 10000
@@ -37,14 +60,160 @@ void spawn_projectile(ecs_table_t* ecs_table, const position_t* position, const
 	ecs_set_lifetime(ecs_table, id, &lifetime);
 }
 
+void spawn_projectile_soa(ecs_soa_table_t* soa_table, const position_t* position, const velocity_t* velocity, const float lifetime)
+{
+	const int32_t id = ecs_soa_activate_entity(soa_table);
+	ecs_soa_add_component(soa_table, id, POSITION);
+	ecs_soa_add_component(soa_table, id, VELOCITY);
+	ecs_soa_add_component(soa_table, id, LIFETIME);
+	ecs_soa_set_position(soa_table, id, position);
+	ecs_soa_set_velocity(soa_table, id, velocity);
+	ecs_soa_set_lifetime(soa_table, id, &(lifetime_t){ .value = lifetime });
+}
+
+void spawn_projectile_world(ecs_world_t* world, const position_t* position, const velocity_t* velocity, const float lifetime)
+{
+	const int32_t id = ecs_world_create_entity(world);
+	ecs_world_add_component(world, id, POSITION);
+	ecs_world_add_component(world, id, VELOCITY);
+	ecs_world_add_component(world, id, LIFETIME);
+	ecs_world_set_position(world, id, position);
+	ecs_world_set_velocity(world, id, velocity);
+	ecs_world_set_lifetime(world, id, &(lifetime_t){ .value = lifetime });
+}
+
+
+// system kernels, same work as the ticks but per entity
+static void move_system(ecs_table_t* ecs_table, const int32_t i0, const int32_t i1, const float delta, void* ctx)
+{
+	(void)ctx;
+	const signature_t* bitmasks = ecs_table->bitmasks;
+	void** components = ecs_table->components;
+	const signature_t mask = SIGNATURE(POSITION, VELOCITY);
+	for (int32_t i = i0; i < i1; ++i)
+	{
+		if (signature_has(bitmasks[i], mask))
+		{
+			position_t* position = components[i * NUM_COMPONENTS + POSITION];
+			const velocity_t* velocity = components[i * NUM_COMPONENTS + VELOCITY];
+			position->x += velocity->x * delta;
+			position->y += velocity->y * delta;
+			position->z += velocity->z * delta;
+		}
+	}
+}
+
+// writes FREE_ENTITY into the signatures, the scheduler keeps it apart from move_system
+static void lifetime_system(ecs_table_t* ecs_table, const int32_t i0, const int32_t i1, const float delta, void* ctx)
+{
+	(void)ctx;
+	signature_t* bitmasks = ecs_table->bitmasks;
+	void** components = ecs_table->components;
+	const signature_t mask = SIGNATURE(LIFETIME);
+	for (int32_t i = i0; i < i1; ++i)
+	{
+		if (signature_has(bitmasks[i], mask))
+		{
+			lifetime_t* lifetime = components[i * NUM_COMPONENTS + LIFETIME];
+			lifetime->value -= delta;
+			signature_flag(bitmasks + i, FREE_ENTITY, lifetime->bits >> 31);
+		}
+	}
+}
+
+// same, but dead entities get destroyed through the command buffers in ctx
+static void lifetime_command_system(ecs_table_t* ecs_table, const int32_t i0, const int32_t i1, const float delta, void* ctx)
+{
+	ecs_commands_t* commands = ctx;
+	const int32_t thread = workers_index();
+	const signature_t* bitmasks = ecs_table->bitmasks;
+	void** components = ecs_table->components;
+	const signature_t mask = SIGNATURE(LIFETIME);
+	for (int32_t i = i0; i < i1; ++i)
+	{
+		if (signature_has(bitmasks[i], mask))
+		{
+			lifetime_t* lifetime = components[i * NUM_COMPONENTS + LIFETIME];
+			lifetime->value -= delta;
+			if (lifetime->bits >> 31)
+			{
+				ecs_commands_destroy_entity(commands, thread, ecs_entity_handle(ecs_table, i));
+			}
+		}
+	}
+}
+
+static int32_t handle_failures = 0;
+
+static void check_handle(const int32_t ok, const char* what)
+{
+	if (!ok)
+	{
+		fprintf(stderr, "handles: %s\n", what);
+		++handle_failures;
+	}
+}
+
+// handles have to survive swap-removes, go stale on destroy and never come back to life
+// when their slot gets reused
+static int32_t handle_test(void)
+{
+	ecs_table_t ecs_table = {0};
+	ecs_table_init(&ecs_table, 16);
+	entity_t handles[4];
+	for (int32_t i = 0; i < 4; ++i)
+	{
+		const int32_t id = ecs_activate_entity(&ecs_table);
+		ecs_add_component(&ecs_table, id, POSITION);
+		ecs_set_position(&ecs_table, id, &(position_t){ .x = (float)i });
+		handles[i] = ecs_entity_handle(&ecs_table, id);
+	}
+	// destroying 1 moves 3 into its row
+	signature_flag(ecs_table.bitmasks + 1, FREE_ENTITY, 1);
+	ecs_destroy_free_entities(&ecs_table);
+	check_handle(ecs_entity_index(&ecs_table, handles[1]) == -1, "destroyed entity still resolves");
+	check_handle(ecs_entity_index(&ecs_table, handles[0]) == 0, "untouched entity moved");
+	check_handle(ecs_entity_index(&ecs_table, handles[2]) == 2, "untouched entity moved");
+	const int32_t moved = ecs_entity_index(&ecs_table, handles[3]);
+	check_handle(moved == 1, "swap-removed entity doesn't resolve to its new row");
+	check_handle(moved >= 0 && ((position_t*)ecs_table.components[moved * NUM_COMPONENTS + POSITION])->x == 3.0f, "handle resolves to the wrong entity");
+	// the next entity reuses the dead slot with a new generation
+	const int32_t id = ecs_activate_entity(&ecs_table);
+	const entity_t reused = ecs_entity_handle(&ecs_table, id);
+	check_handle(reused.id == handles[1].id, "dead handle slot not reused");
+	check_handle(reused.generation != handles[1].generation, "generation not bumped on reuse");
+	check_handle(ecs_entity_index(&ecs_table, reused) == id, "new handle doesn't resolve");
+	check_handle(ecs_entity_index(&ecs_table, handles[1]) == -1, "stale handle resolves to the new entity");
+	// ids that were never handed out
+	check_handle(ecs_entity_index(&ecs_table, (entity_t){ .id = -1 }) == -1, "negative id resolves");
+	check_handle(ecs_entity_index(&ecs_table, (entity_t){ .id = ecs_table.capacity }) == -1, "id past capacity resolves");
+	check_handle(ecs_entity_index(&ecs_table, (entity_t){ .id = INT32_MAX }) == -1, "huge id resolves");
+	for (int32_t i = 0; i < ecs_table.size; ++i)
+	{
+		signature_flag(ecs_table.bitmasks + i, FREE_ENTITY, 1);
+	}
+	ecs_destroy_free_entities(&ecs_table);
+	check_handle(ecs_entity_index(&ecs_table, handles[0]) == -1 && ecs_entity_index(&ecs_table, reused) == -1, "handles outlive their table rows");
+	ecs_table_destroy(&ecs_table);
+	printf("handles: %s\n", handle_failures ? "FAILED" : "ok");
+	return handle_failures;
+}
 
 int main(int argc, char** argv)
 {
+	#ifdef HANDLES
+	if (handle_test() != 0)
+	{
+		return 1;
+	}
+	#endif
 	// ecs table setup
 	ecs_table_t ecs_table = {0};
-	const int32_t size = NUM_COMPONENTS * sizeof(void**) + sizeof(int8_t);
-	ecs_table.components = malloc(ENTITY_CAP * size);
-	ecs_table.bitmasks = ecs_table.components + NUM_COMPONENTS * ENTITY_CAP;
+	ecs_table_init(&ecs_table, ENTITY_CAP);
+	ecs_soa_table_t soa_table = {0};
+	ecs_soa_init(&soa_table, ENTITY_CAP);
+	ecs_world_t world;
+	ecs_world_init(&world, ENTITY_CAP);
 	// spawn config
 	const position_t position0 = {0};
 	const velocity_t velocity0 =
@@ -52,8 +221,16 @@ int main(int argc, char** argv)
 		.x = 10.0f
 	};
 	const float lifetime0 = 3.0f;
+	const void* projectile[NUM_COMPONENTS] =
+	{
+		[POSITION] = &position0,
+		[VELOCITY] = &velocity0,
+		[LIFETIME] = &lifetime0,
+	};
+	const signature_t projectile_mask = SIGNATURE(POSITION, VELOCITY, LIFETIME);
 	const float spawn_freq = lifetime0 / (float)num_total;
 	printf("freq: %f\n", spawn_freq);
+	printf("simd: %s\n", simd_isa());
 	float sum;
 	// clock setup
 	#ifdef _WIN32
@@ -95,7 +272,7 @@ int main(int argc, char** argv)
 	#endif
 	printf("ecs_table.size: %d\n", ecs_table.size);
 	fflush(stdout);
-	ecs_table.size = 0;
+	ecs_table_clear(&ecs_table);
 	ecs_free_all();
 	#endif
 
@@ -127,7 +304,76 @@ int main(int argc, char** argv)
 	#endif
 	printf("ecs_table.size: %d\n", ecs_table.size);
 	fflush(stdout);
-	ecs_table.size = 0;
+	ecs_table_clear(&ecs_table);
+	ecs_free_all();
+	#endif
+
+	#ifdef FUSED_SINGLE
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	// singlethread
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		for (; sum > spawn_freq && num_active < num_total; sum -= spawn_freq)
+		{
+			spawn_projectile(&ecs_table, &position0, &velocity0, lifetime0);
+			++num_active;
+		}
+		num_active = single_thread_tick_fused(&ecs_table, delta);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("fused singly-threaded: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("fused singly-threaded: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("ecs_table.size: %d\n", ecs_table.size);
+	fflush(stdout);
+	ecs_table_clear(&ecs_table);
+	ecs_free_all();
+	#endif
+
+	#ifdef QUERY_SINGLE
+	// cached queries instead of bitmask scans
+	ecs_query_t* movers = ecs_query_create(&ecs_table, SIGNATURE(POSITION, VELOCITY), SIGNATURE_EMPTY);
+	ecs_query_t* agers = ecs_query_create(&ecs_table, SIGNATURE(LIFETIME), SIGNATURE_EMPTY);
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	// singlethread
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		for (; sum > spawn_freq && num_active < num_total; sum -= spawn_freq)
+		{
+			spawn_projectile(&ecs_table, &position0, &velocity0, lifetime0);
+			++num_active;
+		}
+		num_active = single_thread_tick_query(&ecs_table, movers, agers, delta);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("query singly-threaded: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("query singly-threaded: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("ecs_table.size: %d\n", ecs_table.size);
+	fflush(stdout);
+	ecs_query_destroy(&ecs_table, movers);
+	ecs_query_destroy(&ecs_table, agers);
+	ecs_table_clear(&ecs_table);
 	ecs_free_all();
 	#endif
 
@@ -162,7 +408,7 @@ int main(int argc, char** argv)
 	#endif
 	printf("ecs_table.size: %d\n", ecs_table.size);
 	fflush(stdout);
-	ecs_table.size = 0;
+	ecs_table_clear(&ecs_table);
 	ecs_free_all();
 	#endif
 
@@ -194,7 +440,7 @@ int main(int argc, char** argv)
 	#endif
 	printf("ecs_table.size: %d\n", ecs_table.size);
 	fflush(stdout);
-	ecs_table.size = 0;
+	ecs_table_clear(&ecs_table);
 	ecs_free_all();
 	#endif
 
@@ -225,7 +471,7 @@ int main(int argc, char** argv)
 	printf("POSIX multi-threaded: %fs\n", (double)(end - start) / clock_freq);
 	#endif
 	printf("ecs_table.size: %d\n", ecs_table.size);
-	ecs_table.size = 0;
+	ecs_table_clear(&ecs_table);
 	ecs_free_all();
 	#endif
 
@@ -257,7 +503,7 @@ int main(int argc, char** argv)
 	#endif
 	printf("ecs_table.size: %d\n", ecs_table.size);
 	fflush(stdout);
-	ecs_table.size = 0;
+	ecs_table_clear(&ecs_table);
 	ecs_free_all();
 	#endif
 
@@ -289,7 +535,243 @@ int main(int argc, char** argv)
 	#endif
 	printf("ecs_table.size: %d\n", ecs_table.size);
 	fflush(stdout);
-	ecs_table.size = 0;
+	ecs_table_clear(&ecs_table);
+	ecs_free_all();
+	#endif
+
+	#ifdef WORKER_THREAD
+	// worker pool
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		for (; sum > spawn_freq && num_active < num_total; sum -= spawn_freq)
+		{
+			spawn_projectile(&ecs_table, &position0, &velocity0, lifetime0);
+			++num_active;
+		}
+		num_active = multi_thread_tick_workers(&ecs_table, delta, num_threads);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("worker pool multi-threaded1: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("worker pool multi-threaded1: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("ecs_table.size: %d\n", ecs_table.size);
+	fflush(stdout);
+	ecs_table_clear(&ecs_table);
+	ecs_free_all();
+	#endif
+
+	#ifdef WORKER_THREAD2
+	// worker pool, multi_thread_tick2 kernels
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		for (; sum > spawn_freq && num_active < num_total; sum -= spawn_freq)
+		{
+			spawn_projectile(&ecs_table, &position0, &velocity0, lifetime0);
+			++num_active;
+		}
+		num_active = multi_thread_tick2_workers(&ecs_table, delta, num_threads);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("worker pool multi-threaded2: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("worker pool multi-threaded2: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("ecs_table.size: %d\n", ecs_table.size);
+	fflush(stdout);
+	ecs_table_clear(&ecs_table);
+	ecs_free_all();
+	#endif
+
+	#ifdef ALT_WORKER_THREAD
+	// alt worker pool
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		for (; sum > spawn_freq && num_active < num_total; sum -= spawn_freq)
+		{
+			spawn_projectile(&ecs_table, &position0, &velocity0, lifetime0);
+			++num_active;
+		}
+		num_active = multi_thread_tick_alt_workers(&ecs_table, delta, num_threads);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("alt worker pool multi-threaded: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("alt worker pool multi-threaded: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("ecs_table.size: %d\n", ecs_table.size);
+	fflush(stdout);
+	ecs_table_clear(&ecs_table);
+	ecs_free_all();
+	#endif
+
+	#ifdef OTHER_ALT_WORKER_THREAD
+	// other alt worker pool
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		for (; sum > spawn_freq && num_active < num_total; sum -= spawn_freq)
+		{
+			spawn_projectile(&ecs_table, &position0, &velocity0, lifetime0);
+			++num_active;
+		}
+		num_active = multi_thread_tick_other_alt_workers(&ecs_table, delta, num_threads);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("other alt worker pool multi-threaded: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("other alt worker pool multi-threaded: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("ecs_table.size: %d\n", ecs_table.size);
+	fflush(stdout);
+	ecs_table_clear(&ecs_table);
+	ecs_free_all();
+	#endif
+
+	#ifdef STEALING_THREAD
+	// work-stealing
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		for (; sum > spawn_freq && num_active < num_total; sum -= spawn_freq)
+		{
+			spawn_projectile(&ecs_table, &position0, &velocity0, lifetime0);
+			++num_active;
+		}
+		num_active = multi_thread_tick_stealing(&ecs_table, delta, num_threads);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("work-stealing multi-threaded: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("work-stealing multi-threaded: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("ecs_table.size: %d\n", ecs_table.size);
+	fflush(stdout);
+	ecs_table_clear(&ecs_table);
+	ecs_free_all();
+	#endif
+
+	#ifdef SYSTEMS
+	// declared systems on the worker pool
+	ecs_systems_t systems;
+	ecs_systems_init(&systems);
+	ecs_system_register(&systems, "move", move_system, NULL, SIGNATURE(POSITION, VELOCITY), SIGNATURE(POSITION), 4096);
+	ecs_system_register(&systems, "lifetime", lifetime_system, NULL, SIGNATURE(LIFETIME), SIGNATURE(LIFETIME, FREE_ENTITY), 4096);
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		for (; sum > spawn_freq && num_active < num_total; sum -= spawn_freq)
+		{
+			spawn_projectile(&ecs_table, &position0, &velocity0, lifetime0);
+			++num_active;
+		}
+		num_active = ecs_systems_tick(&systems, &ecs_table, delta, num_threads);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("systems multi-threaded: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("systems multi-threaded: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("ecs_table.size: %d\n", ecs_table.size);
+	fflush(stdout);
+	ecs_table_clear(&ecs_table);
+	ecs_free_all();
+	#endif
+
+	#ifdef COMMANDS
+	// spawns and destroys deferred through command buffers
+	static ecs_commands_t commands;
+	ecs_commands_init(&commands);
+	ecs_systems_t command_systems;
+	ecs_systems_init(&command_systems);
+	ecs_system_register(&command_systems, "move", move_system, NULL, SIGNATURE(POSITION, VELOCITY), SIGNATURE(POSITION), 4096);
+	ecs_system_register(&command_systems, "lifetime", lifetime_command_system, &commands, SIGNATURE(LIFETIME), SIGNATURE(LIFETIME), 4096);
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		for (; sum > spawn_freq && num_active < num_total; sum -= spawn_freq)
+		{
+			ecs_commands_spawn(&commands, 0, projectile_mask, projectile);
+			++num_active;
+		}
+		ecs_commands_playback(&commands, &ecs_table);
+		num_active = ecs_systems_tick(&command_systems, &ecs_table, delta, num_threads);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("command buffer multi-threaded: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("command buffer multi-threaded: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("ecs_table.size: %d\n", ecs_table.size);
+	fflush(stdout);
+	ecs_commands_destroy(&commands);
+	ecs_table_clear(&ecs_table);
 	ecs_free_all();
 	#endif
 
@@ -321,10 +803,239 @@ int main(int argc, char** argv)
 	#endif
 	printf("ecs_table.size: %d\n", ecs_table.size);
 	fflush(stdout);
-	ecs_table.size = 0;
+	ecs_table_clear(&ecs_table);
 	ecs_free_all();
 	#endif
 
+	#ifdef OpenMP_SPAWN
+	// OpenMP with the bursts spawned in parallel
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		int32_t burst = 0;
+		for (; sum > spawn_freq && num_active + burst < num_total; sum -= spawn_freq)
+		{
+			++burst;
+		}
+		#pragma omp parallel for
+		for (int32_t j = 0; j < burst; ++j)
+		{
+			spawn_projectile(&ecs_table, &position0, &velocity0, lifetime0);
+		}
+		num_active = openmp_tick(&ecs_table, delta);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("openmp parallel spawn: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("openmp parallel spawn: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("ecs_table.size: %d\n", ecs_table.size);
+	fflush(stdout);
+	ecs_table_clear(&ecs_table);
+	ecs_free_all();
+	#endif
+
+	#ifdef OpenMP_BATCH
+	// OpenMP with the bursts spawned as one batch
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		int32_t burst = 0;
+		for (; sum > spawn_freq && num_active + burst < num_total; sum -= spawn_freq)
+		{
+			++burst;
+		}
+		ecs_spawn_batch(&ecs_table, burst, projectile_mask, projectile);
+		num_active = openmp_tick(&ecs_table, delta);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("openmp batch spawn: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("openmp batch spawn: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("ecs_table.size: %d\n", ecs_table.size);
+	fflush(stdout);
+	ecs_table_clear(&ecs_table);
+	ecs_free_all();
+	#endif
+
+	#ifdef SOA
+	// SoA singlethread
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		for (; sum > spawn_freq && num_active < num_total; sum -= spawn_freq)
+		{
+			spawn_projectile_soa(&soa_table, &position0, &velocity0, lifetime0);
+			++num_active;
+		}
+		num_active = soa_single_thread_tick(&soa_table, delta);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("SoA singly-threaded: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("SoA singly-threaded: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("soa_table.size: %d\n", soa_table.size);
+	fflush(stdout);
+	soa_table.size = 0;
+	#endif
+
+	#ifdef SOA_OpenMP
+	// SoA OpenMP
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		for (; sum > spawn_freq && num_active < num_total; sum -= spawn_freq)
+		{
+			spawn_projectile_soa(&soa_table, &position0, &velocity0, lifetime0);
+			++num_active;
+		}
+		num_active = soa_openmp_tick(&soa_table, delta);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("SoA openmp: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("SoA openmp: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("soa_table.size: %d\n", soa_table.size);
+	fflush(stdout);
+	soa_table.size = 0;
+	#endif
+
+	#ifdef SOA_BATCH
+	// SoA OpenMP with the bursts spawned as one batch
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		int32_t burst = 0;
+		for (; sum > spawn_freq && num_active + burst < num_total; sum -= spawn_freq)
+		{
+			++burst;
+		}
+		ecs_soa_spawn_batch(&soa_table, burst, projectile_mask, projectile);
+		num_active = soa_openmp_tick(&soa_table, delta);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("SoA openmp batch spawn: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("SoA openmp batch spawn: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("soa_table.size: %d\n", soa_table.size);
+	fflush(stdout);
+	soa_table.size = 0;
+	#endif
+
+	#ifdef ARCHETYPE
+	// archetype singlethread
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		for (; sum > spawn_freq && num_active < num_total; sum -= spawn_freq)
+		{
+			spawn_projectile_world(&world, &position0, &velocity0, lifetime0);
+			++num_active;
+		}
+		num_active = archetype_single_thread_tick(&world, delta);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("archetype singly-threaded: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("archetype singly-threaded: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("world.size: %d\n", world.size);
+	fflush(stdout);
+	ecs_world_clear(&world);
+	#endif
+
+	#ifdef ARCHETYPE_OpenMP
+	// archetype OpenMP
+	num_active = 0;
+	sum = 0;
+	#ifdef _WIN32
+	QueryPerformanceCounter(&start);
+	#else
+	start = times(NULL);
+	#endif
+	for (int32_t i = 0; i < N; ++i)
+	{
+		sum += delta;
+		for (; sum > spawn_freq && num_active < num_total; sum -= spawn_freq)
+		{
+			spawn_projectile_world(&world, &position0, &velocity0, lifetime0);
+			++num_active;
+		}
+		num_active = archetype_openmp_tick(&world, delta);
+	}
+	#ifdef _WIN32
+	QueryPerformanceCounter(&end);
+	printf("archetype openmp: %fs\n", (double)(end.QuadPart - start.QuadPart)  / clock_freq.QuadPart);
+	#else
+	end = times(NULL);
+	printf("archetype openmp: %fs\n", (double)(end - start) / clock_freq);
+	#endif
+	printf("world.size: %d\n", world.size);
+	fflush(stdout);
+	ecs_world_clear(&world);
+	#endif
+
+	ecs_soa_destroy(&soa_table);
+	ecs_table_destroy(&ecs_table);
+	ecs_world_destroy(&world);
 
 	return 0;
 }
@@ -0,0 +1,189 @@
+#define _GNU_SOURCE // cpu sets and pthread_setaffinity_np
+#include "numa.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <omp.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "allocators/vmem.h"
+
+#define NUMA_MAX_NODES 64
+#define NUMA_MAX_CPUS CPU_SETSIZE
+
+static struct
+{
+	int32_t num_nodes;
+	int32_t node_ids[NUMA_MAX_NODES]; // sysfs numbering may have holes
+	int32_t* cpus[NUMA_MAX_NODES];
+	int32_t num_cpus[NUMA_MAX_NODES];
+	int32_t pinning;
+	int32_t openmp_pinned; // team size last pinned
+} topology = {0};
+
+static pthread_once_t topology_once = PTHREAD_ONCE_INIT;
+
+// "0-3,8,10-11"
+static int32_t parse_cpulist(const char* list, int32_t* out)
+{
+	int32_t n = 0;
+	while (*list && *list != '\n')
+	{
+		char* end;
+		const long first = strtol(list, &end, 10);
+		long last = first;
+		if (end == list)
+		{
+			break;
+		}
+		if (*end == '-')
+		{
+			list = end + 1;
+			last = strtol(list, &end, 10);
+		}
+		for (long cpu = first; cpu <= last && n < NUMA_MAX_CPUS; ++cpu)
+		{
+			out[n++] = cpu;
+		}
+		list = *end == ',' ? end + 1 : end;
+	}
+	return n;
+}
+
+static void read_topology(void)
+{
+	char path[64];
+	char list[4096];
+	int32_t* cpus = malloc(NUMA_MAX_CPUS * sizeof *cpus);
+	for (int32_t node = 0; node < NUMA_MAX_NODES * 4 && topology.num_nodes < NUMA_MAX_NODES && cpus; ++node)
+	{
+		snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", node);
+		FILE* file = fopen(path, "r");
+		if (!file)
+		{
+			continue;
+		}
+		const int32_t ok = fgets(list, sizeof list, file) != NULL;
+		fclose(file);
+		const int32_t n = ok ? parse_cpulist(list, cpus) : 0;
+		// memory only nodes have nothing to pin to
+		if (n == 0)
+		{
+			continue;
+		}
+		const int32_t k = topology.num_nodes++;
+		topology.node_ids[k] = node;
+		topology.num_cpus[k] = n;
+		topology.cpus[k] = malloc(n * sizeof *cpus);
+		memcpy(topology.cpus[k], cpus, n * sizeof *cpus);
+	}
+	free(cpus);
+	if (topology.num_nodes == 0)
+	{
+		// no sysfs, one node with whatever we may run on
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		sched_getaffinity(0, sizeof set, &set);
+		topology.cpus[0] = malloc(CPU_COUNT(&set) * sizeof *topology.cpus[0]);
+		for (int32_t cpu = 0; cpu < CPU_SETSIZE && topology.cpus[0]; ++cpu)
+		{
+			if (CPU_ISSET(cpu, &set))
+			{
+				topology.cpus[0][topology.num_cpus[0]++] = cpu;
+			}
+		}
+		topology.num_nodes = 1;
+	}
+}
+
+int32_t numa_node_count(void)
+{
+	pthread_once(&topology_once, read_topology);
+	return topology.num_nodes;
+}
+
+static void set_policy(void* base, const size_t size, const int mode, const unsigned long mask)
+{
+	// the kernel wants maxnode one past the highest bit
+	if (syscall(SYS_mbind, base, size, mode, &mask, sizeof mask * 8 + 1, 0) != 0)
+	{
+		fprintf(stderr, "failed to set the memory policy of %zu bytes!\n", size);
+	}
+}
+
+void numa_spread(void* base, const size_t size)
+{
+	const int32_t num_nodes = numa_node_count();
+	if (num_nodes < 2 || !base)
+	{
+		return;
+	}
+	const size_t page_size = vmem_page_size();
+	const size_t pages = (size + page_size - 1) / page_size;
+	for (int32_t k = 0; k < num_nodes; ++k)
+	{
+		const size_t first = pages * k / num_nodes;
+		const size_t last = pages * (k + 1) / num_nodes;
+		if (last > first && topology.node_ids[k] < 64)
+		{
+			set_policy((uint8_t*)base + first * page_size, (last - first) * page_size, MPOL_PREFERRED, 1ul << topology.node_ids[k]);
+		}
+	}
+}
+
+void numa_interleave(void* base, const size_t size)
+{
+	const int32_t num_nodes = numa_node_count();
+	if (num_nodes < 2 || !base)
+	{
+		return;
+	}
+	unsigned long mask = 0;
+	for (int32_t k = 0; k < num_nodes; ++k)
+	{
+		mask |= topology.node_ids[k] < 64 ? 1ul << topology.node_ids[k] : 0;
+	}
+	const size_t page_size = vmem_page_size();
+	set_policy(base, (size + page_size - 1) / page_size * page_size, MPOL_INTERLEAVE, mask);
+}
+
+void numa_set_pinning(const int32_t enabled)
+{
+	topology.pinning = enabled;
+	topology.openmp_pinned = 0;
+}
+
+int32_t numa_pinning(void)
+{
+	return topology.pinning;
+}
+
+void numa_pin(pthread_t thread, const int32_t index, const int32_t count)
+{
+	if (!topology.pinning || count <= 0)
+	{
+		return;
+	}
+	const int32_t num_nodes = numa_node_count();
+	const int32_t node = (int64_t)index * num_nodes / count;
+	// first thread index that lands on node, the ones after it go round its cpus
+	const int32_t first = ((int64_t)node * count + num_nodes - 1) / num_nodes;
+	const int32_t cpu = topology.cpus[node][(index - first) % topology.num_cpus[node]];
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	pthread_setaffinity_np(thread, sizeof set, &set);
+}
+
+void numa_pin_openmp(void)
+{
+	if (!topology.pinning || topology.openmp_pinned == omp_get_max_threads())
+	{
+		return;
+	}
+#pragma omp parallel
+	numa_pin(pthread_self(), omp_get_thread_num(), omp_get_num_threads());
+	topology.openmp_pinned = omp_get_max_threads();
+}
@@ -0,0 +1,37 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+// node placement for multi socket machines, read from /sys/devices/system/node.  On a
+// single node (or without sysfs) the memory policies are no-ops and pinning just keeps
+// threads from migrating.
+//
+// Threads are numbered like the spans they work on, thread i of n gets the i-th slice
+// of the entities.  Pinning puts the first n / nodes threads on node 0, the next ones on
+// node 1 and so on, and spreading binds the first 1 / nodes of an array to node 0, the
+// next to node 1, ... so a full table's span i lives on the node thread i runs on.
+
+int32_t numa_node_count(void);
+
+// binds consecutive slices of [base, base + size) to consecutive nodes.  Only sets the
+// policy, pages land on their node when first touched.
+void numa_spread(void* base, const size_t size);
+
+// round robin pages over every node, for memory every thread hits at random
+void numa_interleave(void* base, const size_t size);
+
+// off by default, pinning changes the affinity of the calling thread too
+void numa_set_pinning(const int32_t enabled);
+
+int32_t numa_pinning(void);
+
+// pins thread as thread index of count, see above.  No-op unless pinning is enabled.
+void numa_pin(pthread_t thread, const int32_t index, const int32_t count);
+
+// pins the OpenMP team, only does work when the team size changed
+void numa_pin_openmp(void);
+
+#endif /* End NUMA_H */
@@ -0,0 +1,167 @@
+#include "profile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+
+static const char* phase_names[NUM_PROFILE_PHASES] = {
+#define X(_, NAME) #NAME,
+	PROFILE_PHASES
+#undef X
+};
+
+static ecs_profile_t profiles[ECS_MAX_PROFILES];
+static int32_t num_profiles = 0;
+
+const char* ecs_profile_phase_name(const profile_phase_t phase)
+{
+	return phase_names[phase];
+}
+
+const ecs_profile_t* ecs_profile_get(const char* name)
+{
+	for (int32_t i = 0; i < num_profiles; ++i)
+	{
+		if (strcmp(profiles[i].name, name) == 0)
+		{
+			return profiles + i;
+		}
+	}
+	return NULL;
+}
+
+int32_t ecs_profile_count(void)
+{
+	return num_profiles;
+}
+
+const ecs_profile_t* ecs_profile_at(const int32_t i)
+{
+	return i >= 0 && i < num_profiles ? profiles + i : NULL;
+}
+
+void ecs_profile_reset(void)
+{
+	memset(profiles, 0x00, sizeof profiles);
+	num_profiles = 0;
+}
+
+void ecs_profile_dump(FILE* out)
+{
+	for (int32_t i = 0; i < num_profiles; ++i)
+	{
+		const ecs_profile_t* profile = profiles + i;
+		if (profile->ticks == 0)
+		{
+			continue;
+		}
+		const double ticks = profile->ticks;
+		fprintf(out, "%s: %lu ticks, %.1fus/tick, %.1f destroyed/tick\n", profile->name, (unsigned long)profile->ticks, profile->tick_ns / ticks / 1e3, profile->destroyed / ticks);
+		for (int32_t p = 0; p < NUM_PROFILE_PHASES; ++p)
+		{
+			if (profile->phase_ns[p] == 0 && profile->entities[p] == 0)
+			{
+				continue;
+			}
+			fprintf(out, "\t%-14s %10.1fus/tick %5.1f%% %12.1f entities/tick\n", phase_names[p], profile->phase_ns[p] / ticks / 1e3, 100.0 * profile->phase_ns[p] / profile->tick_ns, profile->entities[p] / ticks);
+		}
+		for (int32_t t = 0; t < profile->num_threads; ++t)
+		{
+			const int64_t busy = atomic_load(profile->busy_ns + t);
+			fprintf(out, "\tthread %-7d %10.1fus/tick busy %5.1f%%\n", t, busy / ticks / 1e3, 100.0 * busy / profile->tick_ns);
+		}
+	}
+	fflush(out);
+}
+
+#ifdef ECS_PROFILE
+static ecs_profile_t* current = NULL;
+static uint64_t tick_start = 0;
+static uint64_t phase_start[NUM_PROFILE_PHASES];
+
+__attribute__((destructor))
+static void dump_at_exit(void)
+{
+	if (num_profiles > 0)
+	{
+		ecs_profile_dump(stderr);
+	}
+}
+
+uint64_t profile_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void profile_tick_begin(const char* name)
+{
+	ecs_profile_t* profile = (ecs_profile_t*)ecs_profile_get(name);
+	if (!profile)
+	{
+		if (num_profiles == ECS_MAX_PROFILES)
+		{
+			current = NULL;
+			return;
+		}
+		profile = profiles + num_profiles++;
+		profile->name = name;
+	}
+	memset(profile->last_phase_ns, 0x00, sizeof profile->last_phase_ns);
+	current = profile;
+	tick_start = profile_now();
+}
+
+void profile_tick_end(void)
+{
+	if (!current)
+	{
+		return;
+	}
+	const uint64_t ns = profile_now() - tick_start;
+	current->tick_ns += ns;
+	current->last_tick_ns = ns;
+	++current->ticks;
+	current = NULL;
+}
+
+void profile_phase_begin(const profile_phase_t phase)
+{
+	phase_start[phase] = profile_now();
+}
+
+void profile_phase_end(const profile_phase_t phase, const int64_t entities)
+{
+	if (!current)
+	{
+		return;
+	}
+	const uint64_t ns = profile_now() - phase_start[phase];
+	current->phase_ns[phase] += ns;
+	current->last_phase_ns[phase] += ns;
+	current->entities[phase] += entities;
+}
+
+void profile_destroyed(const int64_t n)
+{
+	if (current)
+	{
+		current->destroyed += n;
+	}
+}
+
+void profile_busy(const int32_t thread, const int64_t ns)
+{
+	ecs_profile_t* profile = current;
+	if (!profile || thread < 0 || thread >= ECS_MAX_THREADS)
+	{
+		return;
+	}
+	atomic_fetch_add_explicit(profile->busy_ns + thread, ns, memory_order_relaxed);
+	int32_t seen = __atomic_load_n(&profile->num_threads, __ATOMIC_RELAXED);
+	while (thread >= seen && !__atomic_compare_exchange_n(&profile->num_threads, &seen, thread + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+	}
+}
+#endif
@@ -0,0 +1,94 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "ecs.h"
+
+// per tick function timings, only collected when built with -DECS_PROFILE (make PROFILE=1).
+// Without it every PROFILE_ macro is empty and the api below reports nothing.
+
+#define PROFILE_PHASES \
+	X(PROFILE_DESTROY_SCAN, destroy_scan)	\
+	X(PROFILE_POOL_FREE, pool_free)	\
+	X(PROFILE_COMPACT, compact)	\
+	X(PROFILE_DESTROY, destroy) /* scan, frees and compaction in one loop */	\
+	X(PROFILE_MOVEMENT, movement)	\
+	X(PROFILE_LIFETIME, lifetime)	\
+	X(PROFILE_UPDATE, update) /* movement and lifetime in one loop */
+
+typedef enum profile_phase_t
+{
+#define X(ENUM, _) ENUM,
+	PROFILE_PHASES
+#undef X
+	NUM_PROFILE_PHASES
+} profile_phase_t;
+
+#define ECS_MAX_PROFILES 32
+
+typedef struct ecs_profile_t
+{
+	const char* name; // the tick function
+	uint64_t ticks;
+	uint64_t tick_ns; // summed over every tick
+	uint64_t phase_ns[NUM_PROFILE_PHASES];
+	uint64_t entities[NUM_PROFILE_PHASES]; // processed by the phase
+	uint64_t destroyed;
+	// time each thread spent on work items, idle is tick_ns minus busy.  Only worker pool
+	// and OpenMP threads show up here, fresh threads and single threaded ticks don't.
+	_Atomic int64_t busy_ns[ECS_MAX_THREADS];
+	int32_t num_threads;
+	// just the most recent tick
+	uint64_t last_tick_ns;
+	uint64_t last_phase_ns[NUM_PROFILE_PHASES];
+} ecs_profile_t;
+
+// NULL if the tick never ran
+const ecs_profile_t* ecs_profile_get(const char* name);
+
+int32_t ecs_profile_count(void);
+
+const ecs_profile_t* ecs_profile_at(const int32_t i);
+
+void ecs_profile_reset(void);
+
+// every profile as a table, this also runs at exit if anything got recorded
+void ecs_profile_dump(FILE* out);
+
+const char* ecs_profile_phase_name(const profile_phase_t phase);
+
+#ifdef ECS_PROFILE
+uint64_t profile_now(void);
+void profile_tick_begin(const char* name);
+void profile_tick_end(void);
+void profile_phase_begin(const profile_phase_t phase);
+void profile_phase_end(const profile_phase_t phase, const int64_t entities);
+void profile_destroyed(const int64_t n);
+void profile_busy(const int32_t thread, const int64_t ns);
+
+// NOTE: ticks don't nest and only the calling thread opens phases
+#define PROFILE_TICK_BEGIN(NAME) profile_tick_begin(NAME)
+#define PROFILE_TICK_END() profile_tick_end()
+#define PROFILE_PHASE_BEGIN(PHASE) profile_phase_begin(PHASE)
+#define PROFILE_PHASE_END(PHASE, N) profile_phase_end(PHASE, N)
+#define PROFILE_DESTROYED(N) profile_destroyed(N)
+// one pair per scope, may run on any thread
+#define PROFILE_BUSY_BEGIN() const uint64_t profile_busy_start = profile_now()
+#define PROFILE_BUSY_END(THREAD) profile_busy(THREAD, profile_now() - profile_busy_start)
+// give time spent waiting inside a work item back
+#define PROFILE_IDLE_BEGIN() const uint64_t profile_idle_start = profile_now()
+#define PROFILE_IDLE_END(THREAD) profile_busy(THREAD, -(int64_t)(profile_now() - profile_idle_start))
+#else
+#define PROFILE_TICK_BEGIN(NAME)
+#define PROFILE_TICK_END()
+#define PROFILE_PHASE_BEGIN(PHASE)
+#define PROFILE_PHASE_END(PHASE, N)
+#define PROFILE_DESTROYED(N)
+#define PROFILE_BUSY_BEGIN()
+#define PROFILE_BUSY_END(THREAD)
+#define PROFILE_IDLE_BEGIN()
+#define PROFILE_IDLE_END(THREAD)
+#endif
+
+#endif /* End PROFILE_H */
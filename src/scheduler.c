@@ -0,0 +1,175 @@
+#include "scheduler.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include "workers.h"
+#include "profile.h"
+
+// every split pushes one half, so a deque never holds more than log2(n / grain) ranges
+#define DEQUE_CAP 64
+#define CACHE_LINE 64
+
+// Chase-Lev work-stealing deque of ranges, owner pushes/takes at the bottom and
+// thieves steal from the top.  A range is packed into a single word so reads never tear.
+typedef struct deque_t
+{
+	_Alignas(CACHE_LINE) _Atomic int64_t top;
+	_Alignas(CACHE_LINE) _Atomic int64_t bottom;
+	_Atomic uint64_t ranges[DEQUE_CAP];
+} deque_t;
+
+static struct
+{
+	deque_t* deques;
+	int32_t num_deques;
+	range_func_t func;
+	void* ctx;
+	int32_t grain;
+	_Atomic int32_t remaining; // entities not yet processed
+} scheduler = {0};
+
+#define EMPTY UINT64_MAX
+
+inline static uint64_t pack(const int32_t i, const int32_t n)
+{
+	return (uint64_t)(uint32_t)i << 32 | (uint32_t)n;
+}
+
+inline static int32_t range_begin(const uint64_t range)
+{
+	return (int32_t)(range >> 32);
+}
+
+inline static int32_t range_end(const uint64_t range)
+{
+	return (int32_t)(uint32_t)range;
+}
+
+static void deque_push(deque_t* deque, const uint64_t range)
+{
+	const int64_t b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+	const int64_t t = atomic_load_explicit(&deque->top, memory_order_acquire);
+	assert(b - t < DEQUE_CAP && "work-stealing deque overflow!");
+	atomic_store_explicit(deque->ranges + (b % DEQUE_CAP), range, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+}
+
+static uint64_t deque_take(deque_t* deque)
+{
+	const int64_t b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+	atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	int64_t t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+	if (t > b)
+	{
+		atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+		return EMPTY;
+	}
+	uint64_t range = atomic_load_explicit(deque->ranges + (b % DEQUE_CAP), memory_order_relaxed);
+	if (t == b)
+	{
+		// last one, race the thieves for it
+		if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+		{
+			range = EMPTY;
+		}
+		atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+	}
+	return range;
+}
+
+static uint64_t deque_steal(deque_t* deque)
+{
+	int64_t t = atomic_load_explicit(&deque->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	const int64_t b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+	if (t >= b)
+	{
+		return EMPTY;
+	}
+	const uint64_t range = atomic_load_explicit(deque->ranges + (t % DEQUE_CAP), memory_order_relaxed);
+	if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+	{
+		return EMPTY;
+	}
+	return range;
+}
+
+// split off upper halves onto our own deque until the range is small enough to run
+static void run_range(deque_t* deque, const uint64_t range)
+{
+	const int32_t i = range_begin(range);
+	int32_t n = range_end(range);
+	while (n - i > scheduler.grain)
+	{
+		const int32_t mid = i + (n - i) / 2;
+		deque_push(deque, pack(mid, n));
+		n = mid;
+	}
+	scheduler.func(scheduler.ctx, i, n);
+	atomic_fetch_sub_explicit(&scheduler.remaining, n - i, memory_order_release);
+}
+
+static int scheduler_worker(void* args)
+{
+	(void)args;
+	const int32_t self = workers_index();
+	const int32_t num_deques = scheduler.num_deques;
+	deque_t* deque = scheduler.deques + self;
+	uint32_t seed = 2654435761u * (self + 1);
+	while (atomic_load_explicit(&scheduler.remaining, memory_order_acquire) > 0)
+	{
+		uint64_t range = deque_take(deque);
+		if (range == EMPTY && num_deques > 1)
+		{
+			// xorshift for the victim
+			seed ^= seed << 13;
+			seed ^= seed >> 17;
+			seed ^= seed << 5;
+			const int32_t victim = seed % num_deques;
+			if (victim != self)
+			{
+				range = deque_steal(scheduler.deques + victim);
+			}
+		}
+		if (range == EMPTY)
+		{
+			PROFILE_IDLE_BEGIN();
+			sched_yield();
+			PROFILE_IDLE_END(self);
+			continue;
+		}
+		run_range(deque, range);
+	}
+	return 0;
+}
+
+void ecs_parallel_for(const int32_t n, const int32_t grain, range_func_t func, void* ctx)
+{
+	if (n <= 0)
+	{
+		return;
+	}
+	const int32_t num_workers = workers_count() > 0 ? workers_count() : 1;
+	if (num_workers > scheduler.num_deques)
+	{
+		free(scheduler.deques);
+		scheduler.deques = aligned_alloc(CACHE_LINE, num_workers * sizeof *scheduler.deques);
+		assert(scheduler.deques && "failed to allocate work-stealing deques!");
+		for (int32_t i = 0; i < num_workers; ++i)
+		{
+			atomic_init(&scheduler.deques[i].top, 0);
+			atomic_init(&scheduler.deques[i].bottom, 0);
+		}
+	}
+	scheduler.num_deques = num_workers;
+	scheduler.func = func;
+	scheduler.ctx = ctx;
+	scheduler.grain = grain > 0 ? grain : 1;
+	atomic_store_explicit(&scheduler.remaining, n, memory_order_relaxed);
+	deque_push(scheduler.deques + workers_index(), pack(0, n));
+	workers_run(scheduler_worker, NULL, 0, num_workers);
+}
@@ -0,0 +1,14 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+// kernel over the entity range [i, n), same convention as span_t
+typedef void (*range_func_t)(void* ctx, const int32_t i, const int32_t n);
+
+// runs func over [0, n) on the worker pool.  Ranges are split in halves down to grain
+// entities, each worker keeps its halves on a Chase-Lev deque and idle workers steal
+// the biggest pending half from a random victim.  Blocks until the whole range is done.
+void ecs_parallel_for(const int32_t n, const int32_t grain, range_func_t func, void* ctx);
+
+#endif /* End SCHEDULER_H */
@@ -0,0 +1,293 @@
+#include "simd.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86
+#endif
+
+// xyz never matters, p += delta * v is the same for every float
+_Static_assert(sizeof(position_t) == 3 * sizeof(float), "position_t must be packed floats");
+_Static_assert(sizeof(velocity_t) == 3 * sizeof(float), "velocity_t must be packed floats");
+_Static_assert(sizeof(lifetime_t) == sizeof(float), "lifetime_t must be a single float");
+
+typedef void (*move_kernel_t)(float* restrict p, const float* restrict v, const int32_t n, const float delta);
+typedef void (*decay_kernel_t)(float* restrict l, uint8_t* restrict dead, const int32_t n, const float delta);
+typedef int32_t (*select_kernel_t)(const uint8_t* restrict bytes, const int32_t n, const uint8_t mask, const int32_t base, int32_t* restrict out);
+
+static void move_scalar(float* restrict p, const float* restrict v, const int32_t n, const float delta)
+{
+	for (int32_t k = 0; k < n; ++k)
+	{
+		p[k] += delta * v[k];
+	}
+}
+
+static void decay_scalar(float* restrict l, uint8_t* restrict dead, const int32_t n, const float delta)
+{
+	for (int32_t i = 0; i < n; ++i)
+	{
+		l[i] -= delta;
+	}
+	if (dead)
+	{
+		const uint32_t* bits = (const uint32_t*)l;
+		for (int32_t i = 0; i < n; ++i)
+		{
+			dead[i] = bits[i] >> 31;
+		}
+	}
+}
+
+static int32_t select_scalar(const uint8_t* restrict bytes, const int32_t n, const uint8_t mask, const int32_t base, int32_t* restrict out)
+{
+	int32_t k = 0;
+	if (!out)
+	{
+		for (int32_t i = 0; i < n; ++i)
+		{
+			k += (bytes[i] & mask) == mask;
+		}
+		return k;
+	}
+	// NOTE: no store-always trick, out[k] past the last hit may belong to another thread
+	for (int32_t i = 0; i < n; ++i)
+	{
+		if ((bytes[i] & mask) == mask)
+		{
+			out[k++] = base + i;
+		}
+	}
+	return k;
+}
+
+#ifdef SIMD_X86
+// NOTE: mul then add, not fma, so every isa gives the same positions as the scalar code
+__attribute__((target("sse2")))
+static void move_sse2(float* restrict p, const float* restrict v, const int32_t n, const float delta)
+{
+	const __m128 d = _mm_set1_ps(delta);
+	int32_t k = 0;
+	for (; k + 4 <= n; k += 4)
+	{
+		_mm_storeu_ps(p + k, _mm_add_ps(_mm_loadu_ps(p + k), _mm_mul_ps(d, _mm_loadu_ps(v + k))));
+	}
+	move_scalar(p + k, v + k, n - k, delta);
+}
+
+__attribute__((target("sse2")))
+static void decay_sse2(float* restrict l, uint8_t* restrict dead, const int32_t n, const float delta)
+{
+	const __m128 d = _mm_set1_ps(delta);
+	int32_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		const __m128 x = _mm_sub_ps(_mm_loadu_ps(l + i), d);
+		_mm_storeu_ps(l + i, x);
+		if (dead)
+		{
+			// sign bits down to 0/1 and narrow the lanes to bytes
+			const __m128i s = _mm_srli_epi32(_mm_castps_si128(x), 31);
+			const __m128i w = _mm_packs_epi32(s, s);
+			const int32_t flags = _mm_cvtsi128_si32(_mm_packus_epi16(w, w));
+			memcpy(dead + i, &flags, 4);
+		}
+	}
+	decay_scalar(l + i, dead ? dead + i : NULL, n - i, delta);
+}
+
+__attribute__((target("sse2")))
+static int32_t select_sse2(const uint8_t* restrict bytes, const int32_t n, const uint8_t mask, const int32_t base, int32_t* restrict out)
+{
+	const __m128i m = _mm_set1_epi8(mask);
+	int32_t k = 0;
+	int32_t i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		const __m128i x = _mm_and_si128(_mm_loadu_si128((const __m128i*)(bytes + i)), m);
+		uint32_t hits = _mm_movemask_epi8(_mm_cmpeq_epi8(x, m));
+		if (!out)
+		{
+			k += __builtin_popcount(hits);
+			continue;
+		}
+		for (; hits; hits &= hits - 1)
+		{
+			out[k++] = base + i + __builtin_ctz(hits);
+		}
+	}
+	return k + select_scalar(bytes + i, n - i, mask, base + i, out ? out + k : NULL);
+}
+
+__attribute__((target("avx2")))
+static void move_avx2(float* restrict p, const float* restrict v, const int32_t n, const float delta)
+{
+	const __m256 d = _mm256_set1_ps(delta);
+	int32_t k = 0;
+	for (; k + 16 <= n; k += 16)
+	{
+		const __m256 a = _mm256_add_ps(_mm256_loadu_ps(p + k), _mm256_mul_ps(d, _mm256_loadu_ps(v + k)));
+		const __m256 b = _mm256_add_ps(_mm256_loadu_ps(p + k + 8), _mm256_mul_ps(d, _mm256_loadu_ps(v + k + 8)));
+		_mm256_storeu_ps(p + k, a);
+		_mm256_storeu_ps(p + k + 8, b);
+	}
+	for (; k + 8 <= n; k += 8)
+	{
+		_mm256_storeu_ps(p + k, _mm256_add_ps(_mm256_loadu_ps(p + k), _mm256_mul_ps(d, _mm256_loadu_ps(v + k))));
+	}
+	move_scalar(p + k, v + k, n - k, delta);
+}
+
+__attribute__((target("avx2")))
+static void decay_avx2(float* restrict l, uint8_t* restrict dead, const int32_t n, const float delta)
+{
+	const __m256 d = _mm256_set1_ps(delta);
+	int32_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		const __m256 x = _mm256_sub_ps(_mm256_loadu_ps(l + i), d);
+		_mm256_storeu_ps(l + i, x);
+		if (dead)
+		{
+			const __m256i s = _mm256_srli_epi32(_mm256_castps_si256(x), 31);
+			const __m128i w = _mm_packs_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+			_mm_storel_epi64((__m128i*)(dead + i), _mm_packus_epi16(w, w));
+		}
+	}
+	decay_scalar(l + i, dead ? dead + i : NULL, n - i, delta);
+}
+
+__attribute__((target("avx2")))
+static int32_t select_avx2(const uint8_t* restrict bytes, const int32_t n, const uint8_t mask, const int32_t base, int32_t* restrict out)
+{
+	const __m256i m = _mm256_set1_epi8(mask);
+	int32_t k = 0;
+	int32_t i = 0;
+	for (; i + 32 <= n; i += 32)
+	{
+		const __m256i x = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(bytes + i)), m);
+		uint32_t hits = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, m));
+		if (!out)
+		{
+			k += __builtin_popcount(hits);
+			continue;
+		}
+		// no compress store before avx512, walk the set bits
+		for (; hits; hits &= hits - 1)
+		{
+			out[k++] = base + i + __builtin_ctz(hits);
+		}
+	}
+	return k + select_scalar(bytes + i, n - i, mask, base + i, out ? out + k : NULL);
+}
+
+__attribute__((target("avx512f")))
+static void move_avx512(float* restrict p, const float* restrict v, const int32_t n, const float delta)
+{
+	const __m512 d = _mm512_set1_ps(delta);
+	int32_t k = 0;
+	for (; k + 16 <= n; k += 16)
+	{
+		_mm512_storeu_ps(p + k, _mm512_add_ps(_mm512_loadu_ps(p + k), _mm512_mul_ps(d, _mm512_loadu_ps(v + k))));
+	}
+	// masked tail instead of the scalar loop
+	if (k < n)
+	{
+		const __mmask16 m = (1u << (n - k)) - 1;
+		const __m512 a = _mm512_maskz_loadu_ps(m, p + k);
+		_mm512_mask_storeu_ps(p + k, m, _mm512_add_ps(a, _mm512_mul_ps(d, _mm512_maskz_loadu_ps(m, v + k))));
+	}
+}
+
+__attribute__((target("avx512f")))
+static void decay_avx512(float* restrict l, uint8_t* restrict dead, const int32_t n, const float delta)
+{
+	const __m512 d = _mm512_set1_ps(delta);
+	for (int32_t i = 0; i < n; i += 16)
+	{
+		const __mmask16 m = n - i >= 16 ? 0xffff : (1u << (n - i)) - 1;
+		const __m512 x = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, l + i), d);
+		_mm512_mask_storeu_ps(l + i, m, x);
+		if (dead)
+		{
+			const __m512i s = _mm512_srli_epi32(_mm512_castps_si512(x), 31);
+			_mm512_mask_cvtepi32_storeu_epi8(dead + i, m, s);
+		}
+	}
+}
+
+// byte compares are avx512bw, widening to 32 bit lanes keeps it at avx512f and lines the
+// lanes up with the indices for the compress store
+__attribute__((target("avx512f")))
+static int32_t select_avx512(const uint8_t* restrict bytes, const int32_t n, const uint8_t mask, const int32_t base, int32_t* restrict out)
+{
+	const __m512i m = _mm512_set1_epi32(mask);
+	const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	int32_t k = 0;
+	int32_t i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		const __m512i x = _mm512_and_si512(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(bytes + i))), m);
+		const __mmask16 hits = _mm512_cmpeq_epi32_mask(x, m);
+		if (out)
+		{
+			_mm512_mask_compressstoreu_epi32(out + k, hits, _mm512_add_epi32(lanes, _mm512_set1_epi32(base + i)));
+		}
+		k += __builtin_popcount(hits);
+	}
+	return k + select_scalar(bytes + i, n - i, mask, base + i, out ? out + k : NULL);
+}
+#endif
+
+static move_kernel_t move_kernel = move_scalar;
+static decay_kernel_t decay_kernel = decay_scalar;
+static select_kernel_t select_kernel = select_scalar;
+static const char* isa = "scalar";
+
+__attribute__((constructor))
+static void init_simd(void)
+{
+	const char* force = getenv("ECS_SIMD");
+	force = force && *force ? force : NULL;
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+#define USE(NAME, SUPPORTED) \
+	if ((force ? strcmp(force, #NAME) == 0 : 1) && (SUPPORTED)) \
+	{ \
+		move_kernel = move_##NAME; \
+		decay_kernel = decay_##NAME; \
+		select_kernel = select_##NAME; \
+		isa = #NAME; \
+		return; \
+	}
+	USE(avx512, __builtin_cpu_supports("avx512f"))
+	USE(avx2, __builtin_cpu_supports("avx2"))
+	USE(sse2, __builtin_cpu_supports("sse2"))
+#undef USE
+#endif
+	if (force && strcmp(force, "scalar") != 0)
+	{
+		fprintf(stderr, "ECS_SIMD=%s isn't supported here, using scalar kernels\n", force);
+	}
+}
+
+void simd_move(position_t* restrict positions, const velocity_t* restrict velocities, const int32_t n, const float delta)
+{
+	move_kernel((float*)positions, (const float*)velocities, 3 * n, delta);
+}
+
+void simd_decay(lifetime_t* restrict lifetimes, uint8_t* restrict dead, const int32_t n, const float delta)
+{
+	decay_kernel((float*)lifetimes, dead, n, delta);
+}
+
+int32_t simd_select(const uint8_t* restrict bytes, const int32_t n, const uint8_t mask, const int32_t base, int32_t* restrict out)
+{
+	return select_kernel(bytes, n, mask, base, out);
+}
+
+const char* simd_isa(void)
+{
+	return isa;
+}
@@ -0,0 +1,25 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+#include "components.h"
+
+// hand vectorized kernels for the movement and lifetime systems.  They need the
+// components packed back to back, so they're used by the SoA and archetype tables and
+// the scratch buffers of the buffered ticks.  The best instruction set the cpu supports
+// is picked at startup, set ECS_SIMD=scalar|sse2|avx2|avx512 to force one.
+
+// positions[i] += delta * velocities[i] for n entities
+void simd_move(position_t* restrict positions, const velocity_t* restrict velocities, const int32_t n, const float delta);
+
+// lifetimes[i] -= delta and dead[i] = 1 if it went negative, 0 otherwise.  dead may be NULL.
+void simd_decay(lifetime_t* restrict lifetimes, uint8_t* restrict dead, const int32_t n, const float delta);
+
+// base + i for every i < n with (bytes[i] & mask) == mask, ascending into out.  Only counts
+// if out is NULL.  Returns how many, used to filter byte wide signatures.
+int32_t simd_select(const uint8_t* restrict bytes, const int32_t n, const uint8_t mask, const int32_t base, int32_t* restrict out);
+
+// instruction set the kernels dispatch to
+const char* simd_isa(void);
+
+#endif /* End SIMD_H */
@@ -0,0 +1,284 @@
+#include "soa.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <omp.h>
+#include "components.h"
+#include "fill.h"
+#include "simd.h"
+#include "profile.h"
+#include "allocators/vmem.h"
+#include "numa.h"
+
+// smallest number of entities committed at once
+#define SOA_COMMIT_MIN 4096
+// entities per openmp work item
+#define SOA_BLOCK 4096
+// entities checked at once for a kernel call
+#define SOA_RUN 512
+
+// back every column for at least n entities
+static void soa_reserve(ecs_soa_table_t* soa_table, const int32_t n)
+{
+	const int32_t committed = soa_table->committed;
+	if (n <= committed)
+	{
+		return;
+	}
+	int64_t want = (int64_t)committed * 2;
+	want = want > n ? want : n;
+	want = want > SOA_COMMIT_MIN ? want : SOA_COMMIT_MIN;
+	want = want < soa_table->capacity ? want : soa_table->capacity;
+#define X(_, NAME) vmem_commit(soa_table->NAME, committed * sizeof(NAME##_t), (want - committed) * sizeof(NAME##_t));
+	COMPONENTS
+#undef X
+	vmem_commit(soa_table->bitmasks, committed * sizeof(signature_t), (want - committed) * sizeof(signature_t));
+	soa_table->committed = want;
+}
+
+void ecs_soa_init(ecs_soa_table_t* soa_table, const int32_t capacity)
+{
+	assert(capacity > 0 && capacity <= ECS_MAX_ENTITIES && "table capacity out of range!");
+#define X(_, NAME) \
+	soa_table->NAME = vmem_reserve((size_t)capacity * sizeof(NAME##_t)); \
+	assert(soa_table->NAME && "failed to allocate " #NAME " column!"); \
+	numa_spread(soa_table->NAME, (size_t)capacity * sizeof(NAME##_t));
+	COMPONENTS
+#undef X
+	soa_table->bitmasks = vmem_reserve((size_t)capacity * sizeof *soa_table->bitmasks);
+	assert(soa_table->bitmasks && "failed to allocate bitmasks!");
+	numa_spread(soa_table->bitmasks, (size_t)capacity * sizeof *soa_table->bitmasks);
+	soa_table->size = 0;
+	soa_table->capacity = capacity;
+	soa_table->committed = 0;
+}
+
+void ecs_soa_destroy(ecs_soa_table_t* soa_table)
+{
+#define X(_, NAME) \
+	vmem_release(soa_table->NAME, (size_t)soa_table->capacity * sizeof(NAME##_t)); \
+	soa_table->NAME = NULL;
+	COMPONENTS
+#undef X
+	vmem_release(soa_table->bitmasks, (size_t)soa_table->capacity * sizeof *soa_table->bitmasks);
+	soa_table->bitmasks = NULL;
+	soa_table->size = 0;
+	soa_table->capacity = 0;
+	soa_table->committed = 0;
+}
+
+int32_t ecs_soa_activate_entity(ecs_soa_table_t* soa_table)
+{
+	if (soa_table->size < soa_table->capacity)
+	{
+		soa_reserve(soa_table, soa_table->size + 1);
+		const int32_t i = soa_table->size++;
+		soa_table->bitmasks[i] = SIGNATURE_EMPTY;
+		return i;
+	}
+	else
+	{
+		fprintf(stderr, "TOO MANY ENTITIES!\n");
+		assert(0);
+		return -1;
+	}
+}
+
+void ecs_soa_add_component(ecs_soa_table_t* soa_table, const int32_t id, const component_t component)
+{
+	// zero the slot like pool_calloc does for the pointer tables
+	switch (component)
+	{
+#define X(ENUM, NAME) \
+	case ENUM: \
+		memset(soa_table->NAME + id, 0x00, sizeof(NAME##_t)); \
+		break;
+	COMPONENTS
+#undef X
+	default:
+		assert(0 && "unknown component!");
+	}
+	signature_set(soa_table->bitmasks + id, component);
+}
+
+int32_t ecs_soa_spawn_batch(ecs_soa_table_t* soa_table, const int32_t count, const signature_t mask, const void* const* initializers)
+{
+	const int32_t first = soa_table->size;
+	if (first + count > soa_table->capacity)
+	{
+		fprintf(stderr, "TOO MANY ENTITIES!\n");
+		assert(0);
+		return -1;
+	}
+	soa_reserve(soa_table, first + count);
+	soa_table->size += count;
+	stream_fill(soa_table->bitmasks + first, count, &mask, sizeof mask);
+#define X(ENUM, NAME) \
+	if (signature_test(mask, ENUM)) \
+	{ \
+		if (initializers && initializers[ENUM]) \
+		{ \
+			stream_fill(soa_table->NAME + first, count, initializers[ENUM], sizeof(NAME##_t)); \
+		} \
+		else \
+		{ \
+			memset(soa_table->NAME + first, 0x00, count * sizeof(NAME##_t)); \
+		} \
+	}
+	COMPONENTS
+#undef X
+	return first;
+}
+
+#define X(_, NAME) void ecs_soa_set_##NAME(ecs_soa_table_t* soa_table, const int32_t id, const NAME##_t* value) \
+{ \
+	soa_table->NAME[id] = *value; \
+}
+COMPONENTS
+#undef X
+
+// move the last entity into the hole at i.  Every column gets copied, present or not,
+// since that is cheaper than branching on the bitmask.
+inline static void soa_swap_remove(ecs_soa_table_t* soa_table, const int32_t i)
+{
+	const int32_t m = --soa_table->size;
+	if (i < m)
+	{
+		soa_table->bitmasks[i] = soa_table->bitmasks[m];
+#define X(_, NAME) soa_table->NAME[i] = soa_table->NAME[m];
+		COMPONENTS
+#undef X
+	}
+}
+
+static void soa_destroy_free_entities(ecs_soa_table_t* soa_table)
+{
+	const signature_t* bitmasks = soa_table->bitmasks;
+	const signature_t mask = SIGNATURE(FREE_ENTITY);
+	const int32_t n = soa_table->size;
+	PROFILE_PHASE_BEGIN(PROFILE_DESTROY);
+	for (int32_t i = n - 1; i >= 0; --i)
+	{
+		if (signature_has(bitmasks[i], mask))
+		{
+			soa_swap_remove(soa_table, i);
+		}
+	}
+	PROFILE_DESTROYED(n - soa_table->size);
+	PROFILE_PHASE_END(PROFILE_DESTROY, n);
+}
+
+// 1 if every one of the n entities has all of mask, no early out so it vectorizes
+inline static int32_t match_all(const signature_t* bitmasks, const signature_t mask, const int32_t n)
+{
+	int32_t all = 1;
+#pragma omp simd reduction(&:all)
+	for (int32_t k = 0; k < n; ++k)
+	{
+		all &= signature_has(bitmasks[k], mask);
+	}
+	return all;
+}
+
+// advances i to the next entity in [i, end) that has all of mask and returns how many in a
+// row do, 0 once there are none left
+inline static int32_t next_run(const signature_t* bitmasks, const signature_t mask, int32_t* i, const int32_t end)
+{
+	int32_t k = *i;
+	while (k < end && !signature_has(bitmasks[k], mask))
+	{
+		++k;
+	}
+	int32_t j = k;
+	while (j < end && signature_has(bitmasks[j], mask))
+	{
+		++j;
+	}
+	*i = k;
+	return j - k;
+}
+
+inline static void decay_run(signature_t* restrict bitmasks, lifetime_t* restrict lifetimes, const int32_t n, const float delta)
+{
+	simd_decay(lifetimes, NULL, n, delta);
+#pragma omp simd
+	for (int32_t k = 0; k < n; ++k)
+	{
+		signature_flag(bitmasks + k, FREE_ENTITY, lifetimes[k].bits >> 31);
+	}
+}
+
+// the columns are packed, so runs of matching entities go straight through the simd
+// kernels.  Blocks where everything matches, the usual case, skip finding the runs.
+static void soa_update_range(ecs_soa_table_t* soa_table, const int32_t i0, const int32_t i1, const float delta)
+{
+	signature_t* restrict bitmasks = soa_table->bitmasks;
+	position_t* restrict positions = soa_table->position;
+	const velocity_t* restrict velocities = soa_table->velocity;
+	lifetime_t* restrict lifetimes = soa_table->lifetime;
+	const signature_t pos_mask = SIGNATURE(POSITION, VELOCITY);
+	const signature_t l_mask = SIGNATURE(LIFETIME);
+	for (int32_t b = i0; b < i1; b += SOA_RUN)
+	{
+		const int32_t end = b + SOA_RUN < i1 ? b + SOA_RUN : i1;
+		if (match_all(bitmasks + b, pos_mask, end - b))
+		{
+			simd_move(positions + b, velocities + b, end - b, delta);
+		}
+		else
+		{
+			for (int32_t i = b, n; (n = next_run(bitmasks, pos_mask, &i, end)) > 0; i += n)
+			{
+				simd_move(positions + i, velocities + i, n, delta);
+			}
+		}
+		if (match_all(bitmasks + b, l_mask, end - b))
+		{
+			decay_run(bitmasks + b, lifetimes + b, end - b, delta);
+		}
+		else
+		{
+			for (int32_t i = b, n; (n = next_run(bitmasks, l_mask, &i, end)) > 0; i += n)
+			{
+				decay_run(bitmasks + i, lifetimes + i, n, delta);
+			}
+		}
+	}
+}
+
+int32_t soa_single_thread_tick(ecs_soa_table_t* soa_table, const float delta)
+{
+	PROFILE_TICK_BEGIN(__func__);
+	soa_destroy_free_entities(soa_table);
+	PROFILE_PHASE_BEGIN(PROFILE_UPDATE);
+	soa_update_range(soa_table, 0, soa_table->size, delta);
+	PROFILE_PHASE_END(PROFILE_UPDATE, soa_table->size);
+	PROFILE_TICK_END();
+	return soa_table->size;
+}
+
+int32_t soa_openmp_tick(ecs_soa_table_t* soa_table, const float delta)
+{
+	numa_pin_openmp();
+	PROFILE_TICK_BEGIN(__func__);
+	// NOTE: swap-remove isn't parallel safe, keep the destroy pass serial
+	soa_destroy_free_entities(soa_table);
+	const int32_t n = soa_table->size;
+	const int32_t num_blocks = (n + SOA_BLOCK - 1) / SOA_BLOCK;
+	PROFILE_PHASE_BEGIN(PROFILE_UPDATE);
+#pragma omp parallel
+	{
+		PROFILE_BUSY_BEGIN();
+#pragma omp for nowait
+		for (int32_t b = 0; b < num_blocks; ++b)
+		{
+			const int32_t i0 = b * SOA_BLOCK;
+			soa_update_range(soa_table, i0, i0 + SOA_BLOCK < n ? i0 + SOA_BLOCK : n, delta);
+		}
+		PROFILE_BUSY_END(omp_get_thread_num());
+	}
+	PROFILE_PHASE_END(PROFILE_UPDATE, n);
+	PROFILE_TICK_END();
+	return soa_table->size;
+}
@@ -0,0 +1,40 @@
+#ifndef SOA_H
+#define SOA_H
+
+#include <stdint.h>
+#include "ecs.h"
+
+// one densely packed column per component, all indexed by entity.
+// column i of every component belongs to the same entity, swap-remove keeps them in sync.
+typedef struct ecs_soa_table_t
+{
+#define X(_, NAME) NAME##_t* NAME;
+	COMPONENTS
+#undef X
+	signature_t* bitmasks;
+	int32_t size;
+	// columns are reserved for capacity entities and committed as size grows
+	int32_t capacity;
+	int32_t committed;
+} ecs_soa_table_t;
+
+void ecs_soa_init(ecs_soa_table_t* soa_table, const int32_t capacity);
+
+void ecs_soa_destroy(ecs_soa_table_t* soa_table);
+
+int32_t ecs_soa_activate_entity(ecs_soa_table_t* soa_table);
+
+void ecs_soa_add_component(ecs_soa_table_t* soa_table, const int32_t id, const component_t component);
+
+// same contract as ecs_spawn_batch, the columns get filled with streaming stores
+int32_t ecs_soa_spawn_batch(ecs_soa_table_t* soa_table, const int32_t count, const signature_t mask, const void* const* initializers);
+
+#define X(_, NAME) void ecs_soa_set_##NAME(ecs_soa_table_t* soa_table, const int32_t id, const NAME##_t* value);
+COMPONENTS
+#undef X
+
+int32_t soa_single_thread_tick(ecs_soa_table_t* soa_table, const float delta);
+
+int32_t soa_openmp_tick(ecs_soa_table_t* soa_table, const float delta);
+
+#endif /* End SOA_H */
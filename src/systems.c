@@ -0,0 +1,196 @@
+#include "systems.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include "workers.h"
+#include "profile.h"
+
+// one graph runs at a time, same as the scheduler
+static struct
+{
+	const ecs_systems_t* systems;
+	ecs_table_t* ecs_table;
+	float delta;
+	int32_t num_tasks[ECS_MAX_SYSTEMS];
+	_Atomic int32_t pending[ECS_MAX_SYSTEMS]; // unfinished dependencies
+	_Atomic int32_t next_task[ECS_MAX_SYSTEMS];
+	_Atomic int32_t tasks_left[ECS_MAX_SYSTEMS];
+	_Atomic int32_t ready[ECS_MAX_SYSTEMS]; // systems in the order they became ready, -1 while being published
+	_Atomic int32_t num_ready;
+	_Atomic int32_t num_done;
+} run = {0};
+
+void ecs_systems_init(ecs_systems_t* systems)
+{
+	memset(systems, 0x00, sizeof *systems);
+}
+
+int32_t ecs_system_register(ecs_systems_t* systems, const char* name, system_func_t func, void* ctx, const signature_t reads, const signature_t writes, const int32_t grain)
+{
+	if (systems->num_systems == ECS_MAX_SYSTEMS)
+	{
+		fprintf(stderr, "TOO MANY SYSTEMS!\n");
+		assert(0);
+		return -1;
+	}
+	const int32_t i = systems->num_systems++;
+	systems->systems[i] = (ecs_system_t){
+		.name = name,
+		.func = func,
+		.ctx = ctx,
+		.reads = reads,
+		.writes = writes,
+		.grain = grain,
+	};
+	systems->built = 0;
+	return i;
+}
+
+// flagging FREE_ENTITY read-modify-writes the signature bytes every kernel reads to find
+// its entities, so it conflicts with everything
+inline static int32_t writes_signatures(const ecs_system_t* system)
+{
+	return signature_test(system->writes, FREE_ENTITY);
+}
+
+inline static int32_t conflicts(const ecs_system_t* a, const ecs_system_t* b)
+{
+	return writes_signatures(a) || writes_signatures(b) || signature_any(a->writes, signature_or(b->reads, b->writes)) || signature_any(b->writes, a->reads);
+}
+
+static void build_graph(ecs_systems_t* systems)
+{
+	for (int32_t j = 0; j < systems->num_systems; ++j)
+	{
+		ecs_system_t* system = systems->systems + j;
+		system->num_deps = 0;
+		system->dependents = 0;
+		for (int32_t i = 0; i < j; ++i)
+		{
+			if (conflicts(systems->systems + i, system))
+			{
+				systems->systems[i].dependents |= (uint64_t)1 << j;
+				++system->num_deps;
+			}
+		}
+	}
+	systems->built = 1;
+}
+
+static void publish_ready(const int32_t s)
+{
+	const int32_t slot = atomic_fetch_add(&run.num_ready, 1);
+	atomic_store(run.ready + slot, s);
+}
+
+static void finish_system(const int32_t s)
+{
+	for (uint64_t dependents = run.systems->systems[s].dependents; dependents; dependents &= dependents - 1)
+	{
+		const int32_t d = __builtin_ctzll(dependents);
+		if (atomic_fetch_sub(run.pending + d, 1) == 1)
+		{
+			publish_ready(d);
+		}
+	}
+	// NOTE: after the dependents are out, workers leave once everything is done
+	atomic_fetch_add(&run.num_done, 1);
+}
+
+static void run_task(const int32_t s, const int32_t task)
+{
+	const ecs_system_t* system = run.systems->systems + s;
+	const int32_t n = run.ecs_table->size;
+	const int32_t i0 = system->grain > 0 ? task * system->grain : 0;
+	const int32_t i1 = system->grain > 0 && i0 + system->grain < n ? i0 + system->grain : n;
+	system->func(run.ecs_table, i0, i1, run.delta, system->ctx);
+	if (atomic_fetch_sub(run.tasks_left + s, 1) == 1)
+	{
+		finish_system(s);
+	}
+}
+
+// grab a task from any ready system, oldest first
+static int systems_worker(void* args)
+{
+	(void)args;
+	const int32_t num_systems = run.systems->num_systems;
+	int32_t first = 0; // every ready system before this one has handed out all its tasks
+	while (atomic_load(&run.num_done) < num_systems)
+	{
+		int32_t found = 0;
+		const int32_t num_ready = atomic_load(&run.num_ready);
+		for (int32_t k = first; k < num_ready && !found; ++k)
+		{
+			const int32_t s = atomic_load(run.ready + k);
+			if (s < 0)
+			{
+				continue;
+			}
+			if (atomic_load_explicit(run.next_task + s, memory_order_relaxed) < run.num_tasks[s])
+			{
+				const int32_t task = atomic_fetch_add(run.next_task + s, 1);
+				if (task < run.num_tasks[s])
+				{
+					run_task(s, task);
+					found = 1;
+					continue;
+				}
+			}
+			first += k == first;
+		}
+		if (!found)
+		{
+			PROFILE_IDLE_BEGIN();
+			sched_yield();
+			PROFILE_IDLE_END(workers_index());
+		}
+	}
+	return 0;
+}
+
+int32_t ecs_systems_tick(ecs_systems_t* systems, ecs_table_t* ecs_table, const float delta, const int32_t num_threads)
+{
+	workers_init(num_threads);
+	PROFILE_TICK_BEGIN(__func__);
+	ecs_destroy_free_entities(ecs_table);
+	PROFILE_PHASE_BEGIN(PROFILE_UPDATE);
+	if (!systems->built)
+	{
+		build_graph(systems);
+	}
+	const int32_t num_systems = systems->num_systems;
+	const int32_t n = ecs_table->size;
+	run.systems = systems;
+	run.ecs_table = ecs_table;
+	run.delta = delta;
+	atomic_store(&run.num_ready, 0);
+	atomic_store(&run.num_done, 0);
+	for (int32_t s = 0; s < num_systems; ++s)
+	{
+		const int32_t grain = systems->systems[s].grain;
+		// always at least one task so empty tables still finish every system
+		run.num_tasks[s] = grain > 0 && n > grain ? (n + grain - 1) / grain : 1;
+		atomic_store(run.pending + s, systems->systems[s].num_deps);
+		atomic_store(run.next_task + s, 0);
+		atomic_store(run.tasks_left + s, run.num_tasks[s]);
+		atomic_store(run.ready + s, -1);
+	}
+	for (int32_t s = 0; s < num_systems; ++s)
+	{
+		if (systems->systems[s].num_deps == 0)
+		{
+			publish_ready(s);
+		}
+	}
+	if (num_systems > 0)
+	{
+		workers_run(systems_worker, NULL, 0, workers_count());
+	}
+	PROFILE_PHASE_END(PROFILE_UPDATE, n);
+	PROFILE_TICK_END();
+	return ecs_table->size;
+}
@@ -0,0 +1,45 @@
+#ifndef SYSTEMS_H
+#define SYSTEMS_H
+
+#include <stdint.h>
+#include "ecs.h"
+
+#define ECS_MAX_SYSTEMS 64
+
+// kernel over the entities [i, n) of the table, it checks the bitmasks itself
+typedef void (*system_func_t)(ecs_table_t* ecs_table, const int32_t i, const int32_t n, const float delta, void* ctx);
+
+typedef struct ecs_system_t
+{
+	const char* name;
+	system_func_t func;
+	void* ctx;
+	signature_t reads;
+	signature_t writes;
+	int32_t grain; // entities per task, 0 runs the whole table as one task
+	int32_t num_deps; // earlier systems this one has to wait for
+	uint64_t dependents; // bit per later system waiting on this one
+} ecs_system_t;
+
+// systems run in registration order as far as the data is concerned.  A system waits for
+// every earlier one that writes something it reads or writes, or reads something it
+// writes, anything else may run at the same time.  The bits are component_t values plus
+// FREE_ENTITY for systems that flag entities for destruction.  Those write the signatures
+// every system reads, so they never run next to another system.
+typedef struct ecs_systems_t
+{
+	ecs_system_t systems[ECS_MAX_SYSTEMS];
+	int32_t num_systems;
+	int32_t built;
+} ecs_systems_t;
+
+void ecs_systems_init(ecs_systems_t* systems);
+
+// returns the index of the system
+int32_t ecs_system_register(ecs_systems_t* systems, const char* name, system_func_t func, void* ctx, const signature_t reads, const signature_t writes, const int32_t grain);
+
+// destroys the flagged entities, then runs every system on the worker pool.  Independent
+// systems run concurrently and each system's range is split into grain sized tasks.
+int32_t ecs_systems_tick(ecs_systems_t* systems, ecs_table_t* ecs_table, const float delta, const int32_t num_threads);
+
+#endif /* End SYSTEMS_H */
@@ -0,0 +1,185 @@
+#include "trace.h"
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+typedef struct trace_span_t
+{
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+	int32_t i;
+	int32_t n;
+} trace_span_t;
+
+typedef struct trace_lane_t
+{
+	trace_span_t* spans;
+	uint64_t head; // spans ever recorded, the ring holds the last TRACE_RING_CAP
+	_Atomic int32_t taken;
+} trace_lane_t;
+
+static trace_lane_t lanes[TRACE_MAX_LANES];
+static _Atomic int32_t num_lanes = 0;
+
+// lanes handed out so far
+static int32_t lanes_used(void)
+{
+	const int32_t n = atomic_load(&num_lanes);
+	return n < TRACE_MAX_LANES ? n : TRACE_MAX_LANES;
+}
+
+void ecs_trace_reset(void)
+{
+	const int32_t n = lanes_used();
+	for (int32_t l = 0; l < n; ++l)
+	{
+		lanes[l].head = 0;
+	}
+}
+
+void ecs_trace_dump(FILE* out)
+{
+	const int32_t n = lanes_used();
+	uint64_t origin = UINT64_MAX;
+	for (int32_t l = 0; l < n; ++l)
+	{
+		const trace_lane_t* lane = lanes + l;
+		const uint64_t first = lane->head > TRACE_RING_CAP ? lane->head - TRACE_RING_CAP : 0;
+		for (uint64_t k = first; k < lane->head; ++k)
+		{
+			const uint64_t start = lane->spans[k % TRACE_RING_CAP].start;
+			origin = start < origin ? start : origin;
+		}
+	}
+	fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	const char* sep = "";
+	for (int32_t l = 0; l < n; ++l)
+	{
+		const trace_lane_t* lane = lanes + l;
+		if (lane->head == 0)
+		{
+			continue;
+		}
+		fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"lane %d\"}}", sep, l, l);
+		sep = ",\n";
+		const uint64_t first = lane->head > TRACE_RING_CAP ? lane->head - TRACE_RING_CAP : 0;
+		for (uint64_t k = first; k < lane->head; ++k)
+		{
+			const trace_span_t* span = lane->spans + k % TRACE_RING_CAP;
+			// microseconds, the nanoseconds go after the point
+			fprintf(out, "%s{\"name\":\"%s\",\"cat\":\"ecs\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"i\":%d,\"n\":%d}}",
+			        sep, span->name, l, (span->start - origin) / 1e3, (span->end - span->start) / 1e3, span->i, span->n);
+		}
+	}
+	fprintf(out, "\n]}\n");
+	fflush(out);
+}
+
+int32_t ecs_trace_write(const char* path)
+{
+	FILE* out = fopen(path, "w");
+	if (!out)
+	{
+		fprintf(stderr, "failed to open trace file %s!\n", path);
+		return 0;
+	}
+	ecs_trace_dump(out);
+	fclose(out);
+	return 1;
+}
+
+#ifdef ECS_TRACE
+static pthread_key_t lane_key;
+static pthread_once_t lane_once = PTHREAD_ONCE_INIT;
+static _Thread_local trace_lane_t* current = NULL;
+
+// the thread is gone, someone else can have its lane
+static void release_lane(void* lane)
+{
+	atomic_store_explicit(&((trace_lane_t*)lane)->taken, 0, memory_order_release);
+}
+
+static void create_key(void)
+{
+	pthread_key_create(&lane_key, release_lane);
+}
+
+static trace_lane_t* acquire_lane(void)
+{
+	pthread_once(&lane_once, create_key);
+	trace_lane_t* lane = NULL;
+	while (!lane)
+	{
+		// a released lane first, a fresh one otherwise.  Somebody scanning may grab the
+		// fresh one before we do, then go around again.
+		const int32_t n = lanes_used();
+		for (int32_t l = 0; l < n && !lane; ++l)
+		{
+			int32_t expected = 0;
+			if (atomic_compare_exchange_strong(&lanes[l].taken, &expected, 1))
+			{
+				lane = lanes + l;
+			}
+		}
+		if (!lane)
+		{
+			const int32_t l = atomic_fetch_add(&num_lanes, 1);
+			if (l >= TRACE_MAX_LANES)
+			{
+				return NULL;
+			}
+			int32_t expected = 0;
+			if (atomic_compare_exchange_strong(&lanes[l].taken, &expected, 1))
+			{
+				lane = lanes + l;
+			}
+		}
+	}
+	if (!lane->spans)
+	{
+		lane->spans = malloc(TRACE_RING_CAP * sizeof *lane->spans);
+		if (!lane->spans)
+		{
+			atomic_store(&lane->taken, 0);
+			return NULL;
+		}
+	}
+	pthread_setspecific(lane_key, lane);
+	return lane;
+}
+
+__attribute__((destructor))
+static void write_at_exit(void)
+{
+	if (lanes_used() == 0)
+	{
+		return;
+	}
+	const char* path = getenv("ECS_TRACE");
+	ecs_trace_write(path && *path ? path : "trace.json");
+}
+
+uint64_t trace_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void trace_span(const char* name, const uint64_t start, const uint64_t end, const int32_t i, const int32_t n)
+{
+	if (!current && !(current = acquire_lane()))
+	{
+		return;
+	}
+	trace_span_t* span = current->spans + current->head % TRACE_RING_CAP;
+	span->name = name;
+	span->start = start;
+	span->end = end;
+	span->i = i;
+	span->n = n;
+	++current->head;
+}
+#endif
@@ -0,0 +1,38 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// timeline of the kernels every thread ran, only recorded when built with -DECS_TRACE
+// (make TRACE=1).  Without it every TRACE_ macro is empty and nothing gets written.
+//
+// Each thread records into a ring of the last TRACE_RING_CAP spans.  Rings are handed out
+// as lanes and go back when their thread exits, so the fresh threads every launch of the
+// thrd_create ticks reuse the same few lanes instead of piling up one per thread.
+
+#define TRACE_RING_CAP (1 << 16)
+#define TRACE_MAX_LANES 256
+
+// Chrome trace event JSON, open it in chrome://tracing or ui.perfetto.dev.  Returns 0 if
+// the file couldn't be written.  Written at exit too, to $ECS_TRACE or trace.json.
+int32_t ecs_trace_write(const char* path);
+
+void ecs_trace_dump(FILE* out);
+
+// drops every recorded span.  Neither this nor the dumps may run while a tick does.
+void ecs_trace_reset(void);
+
+#ifdef ECS_TRACE
+uint64_t trace_now(void);
+void trace_span(const char* name, const uint64_t start, const uint64_t end, const int32_t i, const int32_t n);
+
+// one pair per scope, [I, N) is the range the span worked on
+#define TRACE_BEGIN() const uint64_t trace_start = trace_now()
+#define TRACE_END(NAME, I, N) trace_span(NAME, trace_start, trace_now(), I, N)
+#else
+#define TRACE_BEGIN()
+#define TRACE_END(NAME, I, N)
+#endif
+
+#endif /* End TRACE_H */
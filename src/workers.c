@@ -0,0 +1,177 @@
+#include "workers.h"
+#include "profile.h"
+#include "numa.h"
+#include "allocators/frame.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+// spin this many times on the generation before going to sleep
+#define WORKER_SPIN 4096
+
+static struct
+{
+	pthread_t* threads;
+	int32_t num_threads;
+	// current job
+	thrd_start_t func;
+	uint8_t* args;
+	size_t stride;
+	int32_t count;
+	_Atomic int32_t next;
+	_Atomic int32_t busy;
+	_Atomic uint32_t generation;
+	uint32_t start_generation; // generation new workers start from
+	_Atomic int32_t sleepers;
+	_Atomic int32_t quit;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+} pool = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static _Thread_local int32_t worker_index = 0;
+
+inline static void work(void)
+{
+	const thrd_start_t func = pool.func;
+	uint8_t* args = pool.args;
+	const size_t stride = pool.stride;
+	const int32_t count = pool.count;
+	for (int32_t i = atomic_fetch_add_explicit(&pool.next, 1, memory_order_relaxed); i < count;
+	     i = atomic_fetch_add_explicit(&pool.next, 1, memory_order_relaxed))
+	{
+		PROFILE_BUSY_BEGIN();
+		func(args + i * stride);
+		PROFILE_BUSY_END(worker_index);
+	}
+}
+
+static void* worker_main(void* args)
+{
+	worker_index = (int32_t)(intptr_t)args;
+	frame_set_slot(worker_index);
+	numa_pin(pthread_self(), worker_index, pool.num_threads);
+	uint32_t seen = pool.start_generation;
+	for (;;)
+	{
+		uint32_t generation = atomic_load_explicit(&pool.generation, memory_order_acquire);
+		for (int32_t spin = 0; generation == seen && spin < WORKER_SPIN; ++spin)
+		{
+			sched_yield();
+			generation = atomic_load_explicit(&pool.generation, memory_order_acquire);
+		}
+		if (generation == seen)
+		{
+			pthread_mutex_lock(&pool.mutex);
+			atomic_fetch_add(&pool.sleepers, 1);
+			while ((generation = atomic_load(&pool.generation)) == seen)
+			{
+				pthread_cond_wait(&pool.cond, &pool.mutex);
+			}
+			atomic_fetch_sub(&pool.sleepers, 1);
+			pthread_mutex_unlock(&pool.mutex);
+		}
+		seen = generation;
+		if (atomic_load_explicit(&pool.quit, memory_order_relaxed))
+		{
+			return NULL;
+		}
+		work();
+		atomic_fetch_sub_explicit(&pool.busy, 1, memory_order_release);
+	}
+}
+
+static void publish(void)
+{
+	atomic_fetch_add(&pool.generation, 1);
+	if (atomic_load(&pool.sleepers) > 0)
+	{
+		pthread_mutex_lock(&pool.mutex);
+		pthread_cond_broadcast(&pool.cond);
+		pthread_mutex_unlock(&pool.mutex);
+	}
+}
+
+void workers_init(const int32_t num_threads)
+{
+	assert(num_threads > 0 && "need at least one worker!");
+	assert(worker_index == 0 && "workers can't resize their own pool!");
+	if (num_threads == pool.num_threads)
+	{
+		return;
+	}
+	workers_shutdown();
+	pool.threads = malloc(num_threads * sizeof *pool.threads);
+	assert(pool.threads && "failed to allocate worker threads!");
+	pool.num_threads = num_threads;
+	atomic_store(&pool.quit, 0);
+	pool.start_generation = atomic_load(&pool.generation);
+	numa_pin(pthread_self(), 0, num_threads);
+	for (int32_t i = 1; i < num_threads; ++i)
+	{
+		if (pthread_create(pool.threads + i, NULL, worker_main, (void*)(intptr_t)i) != 0)
+		{
+			fprintf(stderr, "failed to create worker thread %d!\n", i);
+			assert(0);
+		}
+	}
+}
+
+void workers_shutdown(void)
+{
+	if (pool.num_threads == 0)
+	{
+		return;
+	}
+	atomic_store(&pool.quit, 1);
+	publish();
+	for (int32_t i = 1; i < pool.num_threads; ++i)
+	{
+		pthread_join(pool.threads[i], NULL);
+	}
+	free(pool.threads);
+	pool.threads = NULL;
+	pool.num_threads = 0;
+}
+
+int32_t workers_count(void)
+{
+	return pool.num_threads;
+}
+
+int32_t workers_index(void)
+{
+	return worker_index;
+}
+
+void workers_run(thrd_start_t func, void* args, const size_t stride, const int32_t count)
+{
+	if (pool.num_threads <= 1 || count == 1)
+	{
+		for (int32_t i = 0; i < count; ++i)
+		{
+			PROFILE_BUSY_BEGIN();
+			func((uint8_t*)args + i * stride);
+			PROFILE_BUSY_END(worker_index);
+		}
+		return;
+	}
+	pool.func = func;
+	pool.args = args;
+	pool.stride = stride;
+	pool.count = count;
+	atomic_store_explicit(&pool.next, 0, memory_order_relaxed);
+	atomic_store_explicit(&pool.busy, pool.num_threads - 1, memory_order_relaxed);
+	publish();
+	work();
+	// barrier: workers are done with the job once busy drops to zero
+	while (atomic_load_explicit(&pool.busy, memory_order_acquire) > 0)
+	{
+		sched_yield();
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <threads.h>
+
+// persistent worker threads.  The calling thread takes part in every dispatch as
+// worker 0, so a pool of num_threads spawns num_threads - 1 threads.
+
+// (re)start the pool with num_threads workers, no-op if it already has that many
+void workers_init(const int32_t num_threads);
+
+void workers_shutdown(void);
+
+int32_t workers_count(void);
+
+// index of the calling worker, 0 on the thread that owns the pool
+int32_t workers_index(void);
+
+// run func(args + i * stride) for i in [0, count) across the pool and wait for all of them.
+// count may exceed the number of workers, items are claimed dynamically.
+void workers_run(thrd_start_t func, void* args, const size_t stride, const int32_t count);
+
+#endif /* End WORKERS_H */